@@ -0,0 +1,209 @@
+/**********************************************
+ ** File: concurrentpqueue.cpp
+ ** Project: CMSC 341 Project 3, Fall 2023
+ ** Author: Joshua Hur
+ ** Date: 11/14/23
+ ** Section: 2
+ ** E-mail: jhur1@umbc.edu
+ **
+ ** This file implements the relaxed MultiQueue declared in concurrentpqueue.h.
+ ** Build with -pthread.
+ ************************************************************************/
+
+#include "concurrentpqueue.h"
+#include <climits>
+#include <functional>
+#include <thread>
+
+// ConcurrentPQueue(prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure, int numQueues)
+// The constructor creates numQueues empty sub-queues
+ConcurrentPQueue::ConcurrentPQueue(prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure, int numQueues)
+    : m_size(0) {
+    m_priorFunc = priFn;
+    m_heapType = heapType;
+    m_emptyKey = (heapType == MINHEAP) ? INT_MAX : INT_MIN;
+    
+    // Point to the constructor that takes the key range of the buckets
+    if (structure == BUCKET) {
+        throw domain_error("A key range must be declared for a bucket queue, use the key range constructor.");
+    }
+    createQueues(PQueue(priFn, heapType, structure), numQueues);
+}
+
+// ConcurrentPQueue(prifn_t priFn, HEAPTYPE heapType, int minKey, int maxKey, int numQueues)
+// The constructor creates numQueues empty bucket queues for the keys in [minKey, maxKey]
+ConcurrentPQueue::ConcurrentPQueue(prifn_t priFn, HEAPTYPE heapType, int minKey, int maxKey, int numQueues)
+    : m_size(0) {
+    m_priorFunc = priFn;
+    m_heapType = heapType;
+    m_emptyKey = (heapType == MINHEAP) ? INT_MAX : INT_MIN;
+    createQueues(PQueue(priFn, heapType, minKey, maxKey), numQueues);
+}
+
+// createQueues(const PQueue& queue, int numQueues)
+// Helper function of the constructors that makes numQueues copies of an empty queue
+void ConcurrentPQueue::createQueues(const PQueue& queue, int numQueues) {
+    if (numQueues <= 0) {
+        numQueues = 2 * (int) thread::hardware_concurrency();
+    }
+    if (numQueues < 2) {
+        numQueues = 2;
+    }
+    
+    m_queues.reserve(numQueues);
+    for (int i = 0; i < numQueues; i++) {
+        m_queues.push_back(unique_ptr<SubQueue>(new SubQueue(queue)));
+        m_queues.back() -> m_topKey.store(m_emptyKey, memory_order_relaxed);
+    }
+}
+
+// SubQueue(const PQueue& queue)
+// The constructor of a sub-queue with the settings of an empty queue
+ConcurrentPQueue::SubQueue::SubQueue(const PQueue& queue)
+    : m_queue(queue), m_topKey(0) {}
+
+// insertPatient(const Patient& patient)
+// Insert a patient into a random sub-queue
+void ConcurrentPQueue::insertPatient(const Patient& patient) {
+    insert(patient);
+}
+
+// insertPatient(Patient&& patient)
+// Insert a patient into a random sub-queue, moving it into the node instead of copying it
+void ConcurrentPQueue::insertPatient(Patient&& patient) {
+    insert(move(patient));
+}
+
+// insert(P&& patient)
+// Helper function of both insertPatient functions
+template <class P>
+void ConcurrentPQueue::insert(P&& patient) {
+    unique_lock<mutex> lock;
+    SubQueue& sub = lockRandom(lock);
+    sub.m_queue.insertPatient(forward<P>(patient));
+    updateTop(sub);
+    m_size.fetch_add(1, memory_order_relaxed);
+}
+
+// lockRandom(unique_lock<mutex>& lock)
+// Helper function of insert(P&& patient) that locks a random sub-queue
+// Busy sub-queues are skipped, so producers rarely wait for each other
+ConcurrentPQueue::SubQueue& ConcurrentPQueue::lockRandom(unique_lock<mutex>& lock) {
+    int count = (int) m_queues.size();
+    for (int attempt = 0; attempt < count; attempt++) {
+        SubQueue& sub = *m_queues[randomIndex()];
+        lock = unique_lock<mutex>(sub.m_lock, try_to_lock);
+        if (lock.owns_lock()) {
+            return sub;
+        }
+    }
+    
+    // Every try failed, wait for one sub-queue
+    SubQueue& sub = *m_queues[randomIndex()];
+    lock = unique_lock<mutex>(sub.m_lock);
+    return sub;
+}
+
+// tryGetNextPatient(Patient& patient)
+// Remove the better top patient of two random sub-queues into patient
+// Return false only when a sweep over every sub-queue found them all empty
+bool ConcurrentPQueue::tryGetNextPatient(Patient& patient) {
+    int count = (int) m_queues.size();
+    
+    // Two-choice dequeue, the top priorities are read without locking
+    for (int attempt = 0; attempt < count && m_size.load(memory_order_relaxed) > 0; attempt++) {
+        SubQueue* first = m_queues[randomIndex()].get();
+        SubQueue* second = m_queues[randomIndex()].get();
+        int firstKey = first -> m_topKey.load(memory_order_relaxed);
+        int secondKey = second -> m_topKey.load(memory_order_relaxed);
+        if (isHigherKey(secondKey, firstKey)) {
+            swap(first, second);
+            swap(firstKey, secondKey);
+        }
+        if (firstKey == m_emptyKey) {
+            continue;
+        }
+        
+        unique_lock<mutex> lock(first -> m_lock, try_to_lock);
+        if (lock.owns_lock() && first -> m_queue.numPatients() > 0) {
+            popLocked(*first, patient);
+            return true;
+        }
+    }
+    
+    // The queue looks empty, check every sub-queue under its lock
+    for (int i = 0; i < count; i++) {
+        SubQueue& sub = *m_queues[i];
+        lock_guard<mutex> lock(sub.m_lock);
+        if (sub.m_queue.numPatients() > 0) {
+            popLocked(sub, patient);
+            return true;
+        }
+    }
+    return false;
+}
+
+// popLocked(SubQueue& sub, Patient& patient)
+// Helper function of tryGetNextPatient(Patient& patient) that removes the top patient of a
+// locked, non-empty sub-queue
+void ConcurrentPQueue::popLocked(SubQueue& sub, Patient& patient) {
+    patient = sub.m_queue.getNextPatient();
+    updateTop(sub);
+    m_size.fetch_sub(1, memory_order_relaxed);
+}
+
+// updateTop(SubQueue& sub)
+// Publish the top priority of a locked sub-queue to the threads choosing a sub-queue
+void ConcurrentPQueue::updateTop(SubQueue& sub) {
+    Node* top = sub.m_queue.topNode();
+    sub.m_topKey.store(top ? top -> getKey() : m_emptyKey, memory_order_relaxed);
+}
+
+// isHigherKey(int a, int b) const
+// Check key 'a' has strictly higher priority than key 'b'
+bool ConcurrentPQueue::isHigherKey(int a, int b) const {
+    return (m_heapType == MAXHEAP) ? a > b : a < b;
+}
+
+// randomIndex()
+// Return the index of a random sub-queue, every thread has its own xorshift generator
+int ConcurrentPQueue::randomIndex() {
+    thread_local unsigned int state = (unsigned int) hash<thread::id>()(this_thread::get_id()) | 1;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (int) (state % m_queues.size());
+}
+
+// numPatients() const
+// Return the number of patients in all sub-queues
+int ConcurrentPQueue::numPatients() const {
+    return m_size.load(memory_order_relaxed);
+}
+
+// numQueues() const
+// Return the number of sub-queues
+int ConcurrentPQueue::numQueues() const {
+    return (int) m_queues.size();
+}
+
+// getPriorityFn() const
+// Return the priority function
+prifn_t ConcurrentPQueue::getPriorityFn() const {
+    return m_priorFunc;
+}
+
+// getHeapType() const
+// Return the type of the heap
+HEAPTYPE ConcurrentPQueue::getHeapType() const {
+    return m_heapType;
+}
+
+// setLatencyRecorder(LatencyRecorder* recorder)
+// Hand the recorder to every sub-queue under its lock
+void ConcurrentPQueue::setLatencyRecorder(LatencyRecorder* recorder) {
+    for (unique_ptr<SubQueue>& sub : m_queues) {
+        lock_guard<mutex> lock(sub -> m_lock);
+        sub -> m_queue.setLatencyRecorder(recorder);
+    }
+}
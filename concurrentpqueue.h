@@ -0,0 +1,76 @@
+/**********************************************
+ ** File: concurrentpqueue.h
+ ** Project: CMSC 341 Project 3, Fall 2023
+ ** Author: Joshua Hur
+ ** Date: 11/14/23
+ ** Section: 2
+ ** E-mail: jhur1@umbc.edu
+ **
+ ** This file contains the thread-safe priority queue for several registration desks
+ ** and clinicians working at the same time. ConcurrentPQueue is a relaxed MultiQueue:
+ ** the patients are spread over several PQueue sub-queues, each with its own lock.
+ ** An insert goes to a random sub-queue, and a dequeue compares the top priorities of
+ ** two random sub-queues and removes the better patient. Patients leave close to, but
+ ** not exactly in, priority order; the error shrinks as the number of patients grows.
+ ************************************************************************/
+
+#ifndef CONCURRENTPQUEUE_H
+#define CONCURRENTPQUEUE_H
+
+#include "pqueue.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+class ConcurrentPQueue {
+public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // contains test functions
+    // numQueues sub-queues, twice the number of hardware threads when it is 0
+    // Throws domain_error for BUCKET, a bucket queue is built from its key range
+    ConcurrentPQueue(prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure, int numQueues = 0);
+    // Sub-queues of the BUCKET structure for the keys in [minKey, maxKey]
+    ConcurrentPQueue(prifn_t priFn, HEAPTYPE heapType, int minKey, int maxKey, int numQueues = 0);
+    void insertPatient(const Patient& input);
+    void insertPatient(Patient&& input);
+    // Remove a patient of (nearly) the highest priority into patient
+    // Return false only when every sub-queue was found empty
+    bool tryGetNextPatient(Patient& patient);
+    // The number of patients, exact only when no other thread is working on the queue
+    int numPatients() const;
+    int numQueues() const;
+    prifn_t getPriorityFn() const;
+    HEAPTYPE getHeapType() const;
+    // Record the latencies of every sub-queue in recorder, null stops recording; the
+    // threads record without locks, see latencyhistogram.h
+    void setLatencyRecorder(LatencyRecorder* recorder);
+
+private:
+    // A sub-queue with its lock and a copy of its top priority that other threads
+    // read without taking the lock; aligned so two sub-queues never share a cache line
+    struct alignas(64) SubQueue {
+        explicit SubQueue(const PQueue& queue);
+        mutex m_lock;               // protects m_queue
+        PQueue m_queue;             // the patients of this sub-queue
+        atomic<int> m_topKey;       // priority of the top patient, m_emptyKey when empty
+    };
+
+    vector<unique_ptr<SubQueue> > m_queues; // every sub-queue
+    atomic<int> m_size;     // number of patients in all sub-queues
+    prifn_t m_priorFunc;    // Function to compute priority
+    HEAPTYPE m_heapType;    // either a MINHEAP or a MAXHEAP
+    int m_emptyKey;         // top priority advertised by an empty sub-queue
+
+    ConcurrentPQueue(const ConcurrentPQueue& rhs);            // a concurrent queue is never copied
+    ConcurrentPQueue& operator=(const ConcurrentPQueue& rhs);
+    void createQueues(const PQueue& queue, int numQueues);
+    template <class P>
+    void insert(P&& patient);
+    SubQueue& lockRandom(unique_lock<mutex>& lock);
+    void popLocked(SubQueue& sub, Patient& patient);
+    void updateTop(SubQueue& sub);
+    bool isHigherKey(int a, int b) const;
+    int randomIndex();
+};
+
+#endif
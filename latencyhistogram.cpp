@@ -0,0 +1,192 @@
+/**********************************************
+ ** File: latencyhistogram.cpp
+ ** Project: CMSC 341 Project 3, Fall 2023
+ ** Author: Joshua Hur
+ ** Date: 11/14/23
+ ** Section: 2
+ ** E-mail: jhur1@umbc.edu
+ **
+ ** This file implements the latency histograms declared in latencyhistogram.h.
+ ************************************************************************/
+
+#include "latencyhistogram.h"
+#include <cstdio>
+
+// percentile(double p) const
+// Walk the buckets up to the rank of p, the answer never exceeds the longest latency
+long long LatencySnapshot::percentile(double p) const {
+    if (m_count == 0) {
+        return 0;
+    }
+    p = (p < 0) ? 0 : (p > 1) ? 1 : p;
+    long long rank = (long long) (p * m_count + 0.5);
+    rank = (rank < 1) ? 1 : rank;
+    long long seen = 0;
+    for (size_t bucket = 0; bucket < m_counts.size(); bucket++) {
+        seen += m_counts[bucket];
+        if (seen >= rank) {
+            long long high = LatencyHistogram::bucketHigh(bucket);
+            return (high < m_max) ? high : m_max;
+        }
+    }
+    return m_max;
+}
+
+// mean() const
+// Return the average latency in nanoseconds, 0 when nothing is recorded
+double LatencySnapshot::mean() const {
+    return (m_count == 0) ? 0 : (double) m_sum / m_count;
+}
+
+// LatencyHistogram()
+// Create an empty histogram with every stripe cleared
+LatencyHistogram::LatencyHistogram() : m_stripes(LATENCYSTRIPES) {
+    reset();
+}
+
+// record(long long nanoseconds)
+// Count one latency in the stripe of this thread; relaxed atomics are enough because the
+// counts are only read as a whole by snapshot()
+void LatencyHistogram::record(long long nanoseconds) {
+    Stripe& stripe = m_stripes[stripeIndex()];
+    stripe.m_counts[bucketOf(nanoseconds)].fetch_add(1, memory_order_relaxed);
+    stripe.m_sum.fetch_add(nanoseconds, memory_order_relaxed);
+    long long longest = stripe.m_max.load(memory_order_relaxed);
+    while (nanoseconds > longest &&
+           !stripe.m_max.compare_exchange_weak(longest, nanoseconds, memory_order_relaxed)) {
+    }
+}
+
+// snapshot() const
+// Add up the stripes into a plain copy of the counts
+LatencySnapshot LatencyHistogram::snapshot() const {
+    LatencySnapshot snapshot;
+    snapshot.m_counts.assign(LATENCYBUCKETS, 0);
+    for (const Stripe& stripe : m_stripes) {
+        for (int bucket = 0; bucket < LATENCYBUCKETS; bucket++) {
+            long long count = stripe.m_counts[bucket].load(memory_order_relaxed);
+            snapshot.m_counts[bucket] += count;
+            snapshot.m_count += count;
+        }
+        snapshot.m_sum += stripe.m_sum.load(memory_order_relaxed);
+        long long longest = stripe.m_max.load(memory_order_relaxed);
+        snapshot.m_max = (longest > snapshot.m_max) ? longest : snapshot.m_max;
+    }
+    return snapshot;
+}
+
+// percentile(double p) const
+// Return the p-th fraction latency of a snapshot taken now
+long long LatencyHistogram::percentile(double p) const {
+    return snapshot().percentile(p);
+}
+
+// count() const
+// Return the number of latencies recorded
+long long LatencyHistogram::count() const {
+    long long total = 0;
+    for (const Stripe& stripe : m_stripes) {
+        for (int bucket = 0; bucket < LATENCYBUCKETS; bucket++) {
+            total += stripe.m_counts[bucket].load(memory_order_relaxed);
+        }
+    }
+    return total;
+}
+
+// reset()
+// Set every count back to zero
+void LatencyHistogram::reset() {
+    for (Stripe& stripe : m_stripes) {
+        for (int bucket = 0; bucket < LATENCYBUCKETS; bucket++) {
+            stripe.m_counts[bucket].store(0, memory_order_relaxed);
+        }
+        stripe.m_sum.store(0, memory_order_relaxed);
+        stripe.m_max.store(0, memory_order_relaxed);
+    }
+}
+
+// bucketOf(long long nanoseconds)
+// The first 2 * LATENCYSUBBUCKETS latencies have a bucket each, above that every power of
+// two is split into LATENCYSUBBUCKETS buckets by the bits after the leading one
+int LatencyHistogram::bucketOf(long long nanoseconds) {
+    if (nanoseconds < 2 * LATENCYSUBBUCKETS) {
+        return (nanoseconds < 0) ? 0 : (int) nanoseconds;
+    }
+    unsigned long long value = (unsigned long long) nanoseconds;
+    const unsigned long long largest = (1ULL << LATENCYMAXBITS) - 1;
+    value = (value > largest) ? largest : value;
+    int shift = 63 - __builtin_clzll(value) - LATENCYSUBBITS;
+    return shift * LATENCYSUBBUCKETS + (int) (value >> shift);
+}
+
+// bucketLow(int bucket)
+// Return the smallest latency that falls in bucket
+long long LatencyHistogram::bucketLow(int bucket) {
+    if (bucket < 2 * LATENCYSUBBUCKETS) {
+        return bucket;
+    }
+    int shift = bucket / LATENCYSUBBUCKETS - 1;
+    return (long long) (bucket % LATENCYSUBBUCKETS + LATENCYSUBBUCKETS) << shift;
+}
+
+// bucketHigh(int bucket)
+// Return the largest latency that falls in bucket
+long long LatencyHistogram::bucketHigh(int bucket) {
+    return (bucket + 1 < LATENCYBUCKETS) ? bucketLow(bucket + 1) - 1 : (1LL << LATENCYMAXBITS) - 1;
+}
+
+// stripeIndex()
+// Every thread takes the next stripe the first time it records, so up to LATENCYSTRIPES
+// threads never write the same cache line
+int LatencyHistogram::stripeIndex() {
+    static atomic<int> nextStripe(0);
+    thread_local int stripe = nextStripe.fetch_add(1, memory_order_relaxed) % LATENCYSTRIPES;
+    return stripe;
+}
+
+// histogram(LATENCYOP op)
+// Return the histogram of an operation
+LatencyHistogram& LatencyRecorder::histogram(LATENCYOP op) {
+    return m_histograms[op];
+}
+
+// histogram(LATENCYOP op) const
+// Return the histogram of an operation
+const LatencyHistogram& LatencyRecorder::histogram(LATENCYOP op) const {
+    return m_histograms[op];
+}
+
+// reset()
+// Clear the histograms of every operation
+void LatencyRecorder::reset() {
+    for (LatencyHistogram& histogram : m_histograms) {
+        histogram.reset();
+    }
+}
+
+// report() const
+// Return the percentiles of every operation that was recorded, in nanoseconds
+string LatencyRecorder::report() const {
+    string text;
+    for (int op = 0; op < NUMLATENCYOPS; op++) {
+        LatencySnapshot snapshot = m_histograms[op].snapshot();
+        if (snapshot.m_count == 0) {
+            continue;
+        }
+        char line[192];
+        snprintf(line, sizeof(line),
+                 "  %-8s count=%lld mean=%.0f p50=%lld p90=%lld p99=%lld p99.9=%lld max=%lld ns\n",
+                 opName((LATENCYOP) op), snapshot.m_count, snapshot.mean(), snapshot.percentile(0.5),
+                 snapshot.percentile(0.9), snapshot.percentile(0.99), snapshot.percentile(0.999),
+                 snapshot.m_max);
+        text += line;
+    }
+    return text;
+}
+
+// opName(LATENCYOP op)
+// Return the name of an operation for the reports
+const char* LatencyRecorder::opName(LATENCYOP op) {
+    const char* const names[] = {"insert", "dequeue", "merge", "rebuild"};
+    return names[op];
+}
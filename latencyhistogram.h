@@ -0,0 +1,119 @@
+/**********************************************
+ ** File: latencyhistogram.h
+ ** Project: CMSC 341 Project 3, Fall 2023
+ ** Author: Joshua Hur
+ ** Date: 11/14/23
+ ** Section: 2
+ ** E-mail: jhur1@umbc.edu
+ **
+ ** This file contains the latency histograms that record how long the queue
+ ** operations take, for the tail latency targets (p99.9 time to the next patient).
+ ** A histogram has log-scaled buckets, 16 per power of two, so a percentile is
+ ** within 1/16 of the true value. Recording is one relaxed atomic increment in
+ ** the stripe of the calling thread, so threads record without locks and without
+ ** sharing cache lines. A LatencyRecorder keeps one histogram per operation and is
+ ** attached to a queue with PQueue::setLatencyRecorder.
+ ** Build with -pthread.
+ ************************************************************************/
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+using namespace std;
+
+const int LATENCYSUBBITS = 4;                       // log2 of the buckets per power of two
+const int LATENCYSUBBUCKETS = 1 << LATENCYSUBBITS;
+const int LATENCYMAXBITS = 48;                      // longer latencies are recorded as 2^48 - 1 ns
+const int LATENCYBUCKETS = (LATENCYMAXBITS - LATENCYSUBBITS + 1) * LATENCYSUBBUCKETS;
+const int LATENCYSTRIPES = 8;                       // threads spread over this many copies of the counts
+
+enum LATENCYOP {INSERTLATENCY, DEQUEUELATENCY, MERGELATENCY, REBUILDLATENCY};
+const int NUMLATENCYOPS = 4;
+
+// The counts of a histogram at one point in time
+struct LatencySnapshot {
+    vector<long long> m_counts;     // m_counts[b] is the number of latencies in bucket b
+    long long m_count = 0;          // number of latencies recorded
+    long long m_sum = 0;            // nanoseconds of all of them
+    long long m_max = 0;            // the longest one, in nanoseconds
+    // The latency in nanoseconds that the fraction p (0 to 1) of the recorded latencies
+    // do not exceed, the upper end of its bucket; 0 when nothing is recorded
+    long long percentile(double p) const;
+    double mean() const;
+};
+
+class LatencyHistogram {
+public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // contains test functions
+    LatencyHistogram();
+    void record(long long nanoseconds);
+    // Sum the stripes; recordings made while it runs may or may not be counted
+    LatencySnapshot snapshot() const;
+    long long percentile(double p) const;
+    long long count() const;
+    // Clear the counts, recordings made while it runs may be lost
+    void reset();
+    static int bucketOf(long long nanoseconds);
+    static long long bucketLow(int bucket);     // smallest latency of a bucket
+    static long long bucketHigh(int bucket);    // largest latency of a bucket
+
+private:
+    // The counts of the threads that hash to one stripe, aligned to its own cache lines
+    struct alignas(64) Stripe {
+        atomic<long long> m_counts[LATENCYBUCKETS];
+        atomic<long long> m_sum;
+        atomic<long long> m_max;
+    };
+
+    vector<Stripe> m_stripes;
+
+    LatencyHistogram(const LatencyHistogram& rhs);              // shared by reference, never copied
+    LatencyHistogram& operator=(const LatencyHistogram& rhs);
+    static int stripeIndex();
+};
+
+class LatencyRecorder {
+public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // contains test functions
+    LatencyHistogram& histogram(LATENCYOP op);
+    const LatencyHistogram& histogram(LATENCYOP op) const;
+    void reset();
+    // One line per operation that was recorded: count, mean, p50, p90, p99, p99.9 and max
+    string report() const;
+    static const char* opName(LATENCYOP op);
+
+private:
+    LatencyHistogram m_histograms[NUMLATENCYOPS];
+};
+
+// Times the scope it lives in and records it, does nothing when the recorder is null
+class LatencyTimer {
+public:
+    LatencyTimer(LatencyRecorder* recorder, LATENCYOP op) : m_recorder(recorder), m_op(op) {
+        if (m_recorder) {
+            m_start = chrono::steady_clock::now();
+        }
+    }
+    ~LatencyTimer() {
+        if (m_recorder) {
+            chrono::steady_clock::duration elapsed = chrono::steady_clock::now() - m_start;
+            m_recorder -> histogram(m_op).record(chrono::duration_cast<chrono::nanoseconds>(elapsed).count());
+        }
+    }
+
+private:
+    LatencyRecorder* m_recorder;
+    LATENCYOP m_op;
+    chrono::steady_clock::time_point m_start;
+
+    LatencyTimer(const LatencyTimer& rhs);
+    LatencyTimer& operator=(const LatencyTimer& rhs);
+};
+
+#endif
@@ -0,0 +1,710 @@
+/**********************************************
+ ** File: mybench.cpp
+ ** Project: CMSC 341 Project 3, Fall 2023
+ ** Author: Joshua Hur
+ ** Date: 11/14/23
+ ** Section: 2
+ ** E-mail: jhur1@umbc.edu
+ **
+ ** This file contains the benchmarks that time the priority queue operations
+ ** at sizes from 1e4 patients up to a maximum size.
+ ** Usage: mybench [maximum number of patients], 10000000 by default
+ ** Build with -pthread.
+ ************************************************************************/
+
+#include "pqueue.h"
+#include "concurrentpqueue.h"
+#include "patientfeed.h"
+#include "latencyhistogram.h"
+#include "persistentpqueue.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <vector>
+using namespace std;
+
+int priorityFn1(const Patient & patient);
+int priorityFn2(const Patient & patient);
+
+// Every call to operator new is counted so the benchmarks can report allocations
+long long allocationCount = 0;
+
+void* operator new(size_t size) {
+    allocationCount++;
+    void* memory = malloc(size == 0 ? 1 : size);
+    if (!memory) {
+        throw bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+// randomPatients(int count, vector<Patient>& patients)
+// Fill the vector with count patients with uniformly distributed triage parameters
+void randomPatients(int count, vector<Patient>& patients) {
+    mt19937 generator(10);
+    uniform_int_distribution<> temperatureGen(MINTEMP, MAXTEMP);
+    uniform_int_distribution<> oxygenGen(MINOX, MAXOX);
+    uniform_int_distribution<> respiratoryGen(MINRR, MAXRR);
+    uniform_int_distribution<> bloodPressureGen(MINBP, MAXBP);
+    uniform_int_distribution<> nurseOpinionGen(MINOPINION, MAXOPINION);
+
+    patients.clear();
+    patients.reserve(count);
+    for (int i = 0; i < count; i++) {
+        patients.push_back(Patient("Erika Drake",
+                                   temperatureGen(generator),
+                                   oxygenGen(generator),
+                                   respiratoryGen(generator),
+                                   bloodPressureGen(generator),
+                                   nurseOpinionGen(generator)));
+    }
+}
+
+// secondsSince(chrono::steady_clock::time_point start)
+// Return the seconds elapsed since start
+double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// structureName(STRUCTURE structure)
+// Return the name of a data structure for the results table
+const char* structureName(STRUCTURE structure) {
+    const char* const names[] = {"skew", "leftist", "bucket", "dary", "pairing"};
+    return names[structure];
+}
+
+// printResult(const string& name, STRUCTURE structure, int count, double seconds)
+// Print one row of the results table
+void printResult(const string& name, STRUCTURE structure, int count, double seconds) {
+    cout << left << setw(32) << name
+         << setw(10) << structureName(structure)
+         << right << setw(10) << count
+         << setw(12) << fixed << setprecision(4) << seconds << " s"
+         << setw(10) << setprecision(1) << seconds * 1e9 / count << " ns/patient" << endl;
+}
+
+// printThroughput(const string& name, STRUCTURE structure, int count, double seconds)
+// Print one row of the results table as records per second
+void printThroughput(const string& name, STRUCTURE structure, int count, double seconds) {
+    cout << left << setw(32) << name
+         << setw(10) << structureName(structure)
+         << right << setw(10) << count
+         << setw(12) << fixed << setprecision(4) << seconds << " s"
+         << setw(10) << setprecision(0) << count / seconds << " records/s" << endl;
+}
+
+// benchRebuild(STRUCTURE structure, const vector<Patient>& patients)
+// Time switching the priority function of a full queue, against the old strategy of
+// deep-copying the heap and reinserting every patient one merge at a time
+void benchRebuild(STRUCTURE structure, const vector<Patient>& patients) {
+    int count = patients.size();
+    PQueue queue(priorityFn2, MINHEAP, structure);
+    for (const Patient& patient : patients) {
+        queue.insertPatient(patient);
+    }
+
+    // Old strategy: a deep copy of the heap, then n allocations and n merges
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    {
+        PQueue copiedQueue(queue);
+        PQueue rebuiltQueue(priorityFn1, MAXHEAP, structure);
+        for (const Patient& patient : patients) {
+            rebuiltQueue.insertPatient(patient);
+        }
+    }
+    printResult("rebuild (copy + reinsert)", structure, count, secondsSince(start));
+
+    // New strategy: detach the nodes in place and heapify them pairwise
+    start = chrono::steady_clock::now();
+    queue.setPriorityFn(priorityFn1, MAXHEAP);
+    printResult("rebuild (setPriorityFn)", structure, count, secondsSince(start));
+
+    start = chrono::steady_clock::now();
+    queue.setStructure(structure == SKEW ? LEFTIST : SKEW);
+    printResult("rebuild (setStructure)", structure, count, secondsSince(start));
+}
+
+// benchBulkLoad(STRUCTURE structure, const vector<Patient>& patients)
+// Time loading a waiting room one insertPatient at a time against the bulk-load constructor
+void benchBulkLoad(STRUCTURE structure, const vector<Patient>& patients) {
+    int count = patients.size();
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    {
+        PQueue queue(priorityFn2, MINHEAP, structure);
+        for (const Patient& patient : patients) {
+            queue.insertPatient(patient);
+        }
+    }
+    printResult("load (insertPatient)", structure, count, secondsSince(start));
+
+    start = chrono::steady_clock::now();
+    {
+        PQueue queue(patients.begin(), patients.end(), priorityFn2, MINHEAP, structure);
+    }
+    printResult("load (bulk constructor)", structure, count, secondsSince(start));
+}
+
+// benchMoves(STRUCTURE structure, int count)
+// Count the allocations of a copy-in/copy-out round trip against moving and emplacing patients
+void benchMoves(STRUCTURE structure, int count) {
+    const string name = "Alastair Connolly";
+    const char* const methods[] = {"insert/drain (copy)", "insert/drain (move)", "insert/drain (emplace)"};
+
+    for (int method = 0; method < 3; method++) {
+        PQueue queue(priorityFn2, MINHEAP, structure);
+        queue.reserve(count);
+
+        long long allocations = allocationCount;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int i = 0; i < count; i++) {
+            if (method == 0) {
+                Patient patient(name, 37, 70 + i % 32, 20, 100, 1 + i % 10);
+                queue.insertPatient(patient);
+            } else if (method == 1) {
+                queue.insertPatient(Patient(name, 37, 70 + i % 32, 20, 100, 1 + i % 10));
+            } else {
+                queue.emplacePatient(name, 37, 70 + i % 32, 20, 100, 1 + i % 10);
+            }
+        }
+        while (queue.numPatients() > 0) {
+            queue.getNextPatient();
+        }
+        printResult(methods[method], structure, count, secondsSince(start));
+        cout << "    allocations per patient: " << (double) (allocationCount - allocations) / count << endl;
+    }
+}
+
+// benchBatch(STRUCTURE structure, const vector<Patient>& patients)
+// Time taking the top k patients of a full queue with k calls of getNextPatient against
+// one call of getNextPatients, for a shift of 20 beds and for a tenth of the queue
+void benchBatch(STRUCTURE structure, const vector<Patient>& patients) {
+    int count = patients.size();
+    const int sizes[] = {20, count / 10};
+
+    for (int k : sizes) {
+        vector<Patient> beds(k);
+        for (int method = 0; method < 2; method++) {
+            PQueue queue(patients.begin(), patients.end(), priorityFn2, MINHEAP, structure);
+
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            if (method == 0) {
+                for (int i = 0; i < k; i++) {
+                    beds[i] = queue.getNextPatient();
+                }
+            } else {
+                queue.getNextPatients(k, beds.begin());
+            }
+            double seconds = secondsSince(start);
+
+            string name = "top k of " + to_string(count) + (method == 0 ? " (loop)" : " (batch)");
+            printResult(name, structure, k, seconds);
+        }
+    }
+}
+
+// benchPeek(STRUCTURE structure, const vector<Patient>& patients)
+// Time a dashboard refresh of the top 20 patients: copying the queue and draining the copy
+// against peekTopK, which leaves the queue untouched, on a bulk-loaded queue and on one
+// filled an insert at a time
+void benchPeek(STRUCTURE structure, const vector<Patient>& patients) {
+    const int k = 20;
+    const int refreshes = 10;
+    PQueue queue(patients.begin(), patients.end(), priorityFn2, MINHEAP, structure);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int r = 0; r < refreshes; r++) {
+        PQueue copiedQueue(queue);
+        vector<Patient> top;
+        copiedQueue.getNextPatients(k, back_inserter(top));
+    }
+    printResult("top 20 (copy + drain)", structure, (int) patients.size(), secondsSince(start) / refreshes);
+
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < refreshes; r++) {
+        vector<Patient> top = queue.peekTopK(k);
+    }
+    printResult("top 20 (peekTopK)", structure, (int) patients.size(), secondsSince(start) / refreshes);
+
+    // Inserted one at a time, the root of a pairing heap has a child per patient until
+    // dequeues pair them up, and the peek reads every one of them
+    PQueue insertedQueue(priorityFn2, MINHEAP, structure);
+    for (const Patient& patient : patients) {
+        insertedQueue.insertPatient(patient);
+    }
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < refreshes; r++) {
+        vector<Patient> top = insertedQueue.peekTopK(k);
+    }
+    printResult("top 20 (peekTopK, one by one)", structure, (int) patients.size(), secondsSince(start) / refreshes);
+}
+
+// benchRetriage(STRUCTURE structure, const vector<Patient>& patients)
+// Time a re-triage round where a tenth of the patients get new vitals: updating them through
+// their handles against draining the whole queue and inserting it again
+void benchRetriage(STRUCTURE structure, const vector<Patient>& patients) {
+    int count = patients.size();
+    int updates = count / 10;
+    PQueue queue(priorityFn2, MINHEAP, structure);
+    vector<PatientHandle> handles;
+    handles.reserve(count);
+    for (const Patient& patient : patients) {
+        handles.push_back(queue.insertPatient(patient));
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    {
+        vector<Patient> drained;
+        queue.getNextPatients(count, back_inserter(drained));
+        queue.insertPatients(drained.begin(), drained.end());
+    }
+    printResult("re-triage (drain + reinsert)", structure, count, secondsSince(start));
+
+    // The drained queue has new nodes, so the handles are taken again
+    queue.clear();
+    handles.clear();
+    for (const Patient& patient : patients) {
+        handles.push_back(queue.insertPatient(patient));
+    }
+
+    mt19937 generator(3);
+    uniform_int_distribution<> indexGen(0, count - 1);
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < updates; i++) {
+        int index = indexGen(generator);
+        Patient patient = patients[index];
+        patient.setOpinion(1 + i % 10);
+        queue.updatePatient(handles[index], patient);
+    }
+    printResult("re-triage (updatePatient)", structure, count, secondsSince(start));
+}
+
+// benchCancel(STRUCTURE structure, const vector<Patient>& patients)
+// Time dropping a fifth of the patients, in random order, with removePatient against
+// cancelPatient, then draining the queue so the cost of the tombstones shows too
+void benchCancel(STRUCTURE structure, const vector<Patient>& patients) {
+    int count = patients.size();
+    vector<int> order(count);
+    for (int i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    shuffle(order.begin(), order.end(), mt19937(5));
+    order.resize(count / 5);
+
+    for (int method = 0; method < 2; method++) {
+        PQueue queue(priorityFn2, MINHEAP, structure);
+        vector<PatientHandle> handles;
+        handles.reserve(count);
+        for (const Patient& patient : patients) {
+            handles.push_back(queue.insertPatient(patient));
+        }
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int index : order) {
+            if (method == 0) {
+                queue.removePatient(handles[index]);
+            } else {
+                queue.cancelPatient(handles[index]);
+            }
+        }
+        printResult(method == 0 ? "drop 20% (removePatient)" : "drop 20% (cancelPatient)",
+                    structure, (int) order.size(), secondsSince(start));
+
+        start = chrono::steady_clock::now();
+        while (queue.numPatients() > 0) {
+            queue.getNextPatient();
+        }
+        printResult(method == 0 ? "  then drain" : "  then drain with tombstones",
+                    structure, count, secondsSince(start));
+    }
+}
+
+// benchLazyMerge(STRUCTURE structure, const vector<Patient>& patients)
+// Time folding 50 site queues into one with eager and with lazy merges, then the first
+// dequeue, which pays for the deferred melding, and the drain of the rest
+void benchLazyMerge(STRUCTURE structure, const vector<Patient>& patients) {
+    const int numSites = 50;
+    int count = patients.size();
+
+    for (int lazy = 0; lazy < 2; lazy++) {
+        vector<PQueue> sites;
+        for (int site = 0; site < numSites; site++) {
+            sites.emplace_back(priorityFn2, MINHEAP, structure);
+        }
+        for (int i = 0; i < count; i++) {
+            sites[i % numSites].insertPatient(patients[i]);
+        }
+
+        PQueue queue(priorityFn2, MINHEAP, structure);
+        queue.setLazyMerge(lazy == 1);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (PQueue& site : sites) {
+            queue.mergeWithQueue(site);
+        }
+        printResult(lazy ? "fold 50 sites (lazy)" : "fold 50 sites (eager)", structure, numSites, secondsSince(start));
+
+        start = chrono::steady_clock::now();
+        queue.getNextPatient();
+        printResult("  then first dequeue", structure, 1, secondsSince(start));
+
+        start = chrono::steady_clock::now();
+        while (queue.numPatients() > 0) {
+            queue.getNextPatient();
+        }
+        printResult("  then drain", structure, count - 1, secondsSince(start));
+    }
+}
+
+// benchMergeAll(STRUCTURE structure, const vector<Patient>& patients)
+// Time consolidating 64 regional queues by chaining mergeWithQueue against mergeAll on one
+// and on four threads, then draining the result, whose shape the merge order decides
+void benchMergeAll(STRUCTURE structure, const vector<Patient>& patients) {
+    const int numRegions = 64;
+    const char* const names[] = {"merge 64 regions (chained)", "merge 64 regions (mergeAll x1)",
+                                 "merge 64 regions (mergeAll x4)"};
+    int count = patients.size();
+
+    for (int method = 0; method < 3; method++) {
+        vector<PQueue> regions;
+        for (int region = 0; region < numRegions; region++) {
+            regions.emplace_back(priorityFn2, MINHEAP, structure);
+        }
+        for (int i = 0; i < count; i++) {
+            regions[i % numRegions].insertPatient(patients[i]);
+        }
+        vector<PQueue*> pointers;
+        for (PQueue& region : regions) {
+            pointers.push_back(&region);
+        }
+
+        PQueue queue(priorityFn2, MINHEAP, structure);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if (method == 0) {
+            for (PQueue* region : pointers) {
+                queue.mergeWithQueue(*region);
+            }
+        } else {
+            queue.mergeAll(pointers, method == 1 ? 1 : 4);
+        }
+        printResult(names[method], structure, numRegions, secondsSince(start));
+
+        start = chrono::steady_clock::now();
+        while (queue.numPatients() > 0) {
+            queue.getNextPatient();
+        }
+        printResult("  then drain", structure, count, secondsSince(start));
+    }
+}
+
+// benchSnapshot(STRUCTURE structure, const vector<Patient>& patients)
+// Time a cold start: re-inserting every waiting patient one at a time against loading a
+// snapshot of the same queue, plus the time it takes to write the snapshot
+void benchSnapshot(STRUCTURE structure, const vector<Patient>& patients) {
+    const string path = "mybench.snapshot";
+    int count = patients.size();
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    PQueue queue(priorityFn2, MINHEAP, structure);
+    for (const Patient& patient : patients) {
+        queue.insertPatient(patient);
+    }
+    printResult("cold start (insertPatient)", structure, count, secondsSince(start));
+
+    start = chrono::steady_clock::now();
+    queue.saveSnapshot(path);
+    printResult("  save snapshot", structure, count, secondsSince(start));
+
+    start = chrono::steady_clock::now();
+    PQueue restored(priorityFn2, MINHEAP, structure);
+    restored.loadSnapshot(path);
+    printResult("cold start (loadSnapshot)", structure, count, secondsSince(start));
+    remove(path.c_str());
+}
+
+// benchMixed(STRUCTURE structure, const vector<Patient>& patients)
+// Time a mixed trace like a day of intake: every batch of 1000 patients is queued at its
+// own desk, merged into the main queue, and then half a batch is dequeued
+void benchMixed(STRUCTURE structure, const vector<Patient>& patients) {
+    const int batchSize = 1000;
+    int count = patients.size();
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    {
+        PQueue queue(priorityFn2, MINHEAP, structure);
+        for (int first = 0; first < count; first += batchSize) {
+            int last = (first + batchSize < count) ? first + batchSize : count;
+            PQueue desk(priorityFn2, MINHEAP, structure);
+            for (int i = first; i < last; i++) {
+                desk.insertPatient(patients[i]);
+            }
+            queue.mergeWithQueue(desk);
+            for (int i = 0; i < batchSize / 2 && queue.numPatients() > 0; i++) {
+                queue.getNextPatient();
+            }
+        }
+        while (queue.numPatients() > 0) {
+            queue.getNextPatient();
+        }
+    }
+    printResult("insert/merge/drain (mixed)", structure, count, secondsSince(start));
+}
+
+// benchLatency(STRUCTURE structure, const vector<Patient>& patients)
+// Time the mixed intake trace without and with a latency recorder, then print the
+// latency percentiles of the recorded operations
+void benchLatency(STRUCTURE structure, const vector<Patient>& patients) {
+    const int batchSize = 1000;
+    int count = patients.size();
+    LatencyRecorder recorder;
+
+    for (int recorded = 0; recorded < 2; recorded++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        {
+            PQueue queue(priorityFn2, MINHEAP, structure);
+            queue.setLatencyRecorder(recorded ? &recorder : nullptr);
+            for (int first = 0; first < count; first += batchSize) {
+                int last = (first + batchSize < count) ? first + batchSize : count;
+                PQueue desk(priorityFn2, MINHEAP, structure);
+                desk.setLatencyRecorder(queue.getLatencyRecorder());
+                for (int i = first; i < last; i++) {
+                    desk.insertPatient(patients[i]);
+                }
+                queue.mergeWithQueue(desk);
+                for (int i = 0; i < batchSize / 2 && queue.numPatients() > 0; i++) {
+                    queue.getNextPatient();
+                }
+            }
+            queue.setPriorityFn(priorityFn1, MAXHEAP);
+            while (queue.numPatients() > 0) {
+                queue.getNextPatient();
+            }
+        }
+        printResult(recorded ? "mixed (latency recorder)" : "mixed (no recorder)", structure, count,
+                    secondsSince(start));
+    }
+    cout << recorder.report();
+}
+
+// benchPersistent(const vector<Patient>& patients)
+// Time what-if triage on a full queue: 100 times, copy it, insert a patient into the copy
+// and dequeue from it; a leftist PQueue deep-copies, the persistent queue shares its nodes
+void benchPersistent(const vector<Patient>& patients) {
+    const int rounds = 100;
+    int count = patients.size();
+    PQueue queue(patients.begin(), patients.end(), priorityFn2, MINHEAP, LEFTIST);
+    PersistentPQueue persistent(priorityFn2, MINHEAP);
+    for (const Patient& patient : patients) {
+        persistent.insertPatient(patient);
+    }
+
+    for (int method = 0; method < 2; method++) {
+        long long allocations = allocationCount;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++) {
+            if (method == 0) {
+                PQueue whatIf(queue);
+                whatIf.insertPatient(patients[round]);
+                whatIf.getNextPatient();
+            } else {
+                PersistentPQueue whatIf(persistent);
+                whatIf.insertPatient(patients[round]);
+                whatIf.getNextPatient();
+            }
+        }
+        double seconds = secondsSince(start);
+        printResult(method == 0 ? "what-if x100 (PQueue)" : "what-if x100 (persistent)", LEFTIST, count, seconds);
+        cout << "    allocations per copy: " << (double) (allocationCount - allocations) / rounds << endl;
+    }
+}
+
+// benchBucket(const vector<Patient>& patients)
+// Time an insert/drain round trip of a bucket queue over the key range of priorityFn2,
+// against the same round trip with every key in the overflow heap
+void benchBucket(const vector<Patient>& patients) {
+    int count = patients.size();
+    const int ranges[][2] = {{71, 111}, {0, 0}};
+    const char* const names[] = {"insert/drain (bucket)", "insert/drain (overflow)"};
+
+    for (int range = 0; range < 2; range++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        {
+            PQueue queue(priorityFn2, MINHEAP, ranges[range][0], ranges[range][1]);
+            queue.reserve(count);
+            for (const Patient& patient : patients) {
+                queue.insertPatient(patient);
+            }
+            while (queue.numPatients() > 0) {
+                queue.getNextPatient();
+            }
+        }
+        printResult(names[range], BUCKET, count, secondsSince(start));
+    }
+}
+
+// benchIngest(const vector<Patient>& patients)
+// Time loading a CSV feed the old way, a line at a time through getline, stoi, the
+// Patient constructor and insertPatient, against PatientFeed on the CSV and binary feeds
+void benchIngest(const vector<Patient>& patients) {
+    const string csvPath = "mybench_feed.csv";
+    const string binaryPath = "mybench_feed.bin";
+    int count = patients.size();
+    {
+        ofstream file(csvPath);
+        for (const Patient& patient : patients) {
+            file << patient.getPatient() << "," << patient.getTemperature() << "," << patient.getOxygen() << ","
+                 << patient.getRR() << "," << patient.getBP() << "," << patient.getOpinion() << "\n";
+        }
+    }
+    PatientFeed::writeBinary(binaryPath, patients);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    {
+        PQueue queue(priorityFn2, MINHEAP, SKEW);
+        ifstream file(csvPath);
+        string line;
+        while (getline(file, line)) {
+            stringstream row(line);
+            string name, field;
+            int vitals[5];
+            getline(row, name, ',');
+            for (int i = 0; i < 5; i++) {
+                getline(row, field, ',');
+                vitals[i] = stoi(field);
+            }
+            queue.insertPatient(Patient(name, vitals[0], vitals[1], vitals[2], vitals[3], vitals[4]));
+        }
+    }
+    printThroughput("ingest CSV (getline)", SKEW, count, secondsSince(start));
+
+    start = chrono::steady_clock::now();
+    {
+        PQueue queue(priorityFn2, MINHEAP, SKEW);
+        PatientFeed feed(csvPath, CSVFEED);
+        feed.readInto(queue);
+    }
+    printThroughput("ingest CSV (PatientFeed)", SKEW, count, secondsSince(start));
+
+    start = chrono::steady_clock::now();
+    {
+        PQueue queue(priorityFn2, MINHEAP, SKEW);
+        PatientFeed feed(binaryPath, BINARYFEED);
+        feed.readInto(queue);
+    }
+    printThroughput("ingest binary (PatientFeed)", SKEW, count, secondsSince(start));
+    remove(csvPath.c_str());
+    remove(binaryPath.c_str());
+}
+
+// benchConcurrent(const vector<Patient>& patients, int numThreads)
+// Time numThreads threads that each insert their share of the patients and dequeue one patient
+// after every insert, with one PQueue behind a single mutex against the concurrent queue
+void benchConcurrent(const vector<Patient>& patients, int numThreads) {
+    int count = patients.size();
+    const char* const names[] = {"threads x%d (mutex PQueue)", "threads x%d (ConcurrentPQueue)"};
+
+    for (int method = 0; method < 2; method++) {
+        PQueue lockedQueue(priorityFn2, MINHEAP, SKEW);
+        mutex queueLock;
+        ConcurrentPQueue concurrentQueue(priorityFn2, MINHEAP, SKEW, 2 * numThreads);
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        vector<thread> threads;
+        for (int t = 0; t < numThreads; t++) {
+            threads.push_back(thread([&, t]() {
+                Patient patient;
+                for (int i = t; i < count; i += numThreads) {
+                    if (method == 0) {
+                        lock_guard<mutex> lock(queueLock);
+                        lockedQueue.insertPatient(patients[i]);
+                        if (i % 2 == 1) {
+                            patient = lockedQueue.getNextPatient();
+                        }
+                    } else {
+                        concurrentQueue.insertPatient(patients[i]);
+                        if (i % 2 == 1) {
+                            concurrentQueue.tryGetNextPatient(patient);
+                        }
+                    }
+                }
+            }));
+        }
+        for (thread& t : threads) {
+            t.join();
+        }
+
+        char name[64];
+        snprintf(name, sizeof(name), names[method], numThreads);
+        printResult(name, SKEW, count, secondsSince(start));
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int maxCount = 10000000;
+    if (argc > 1) {
+        maxCount = atoi(argv[1]);
+    }
+
+    const STRUCTURE structures[] = {SKEW, LEFTIST, DARY, PAIRING};
+    vector<Patient> patients;
+    for (int count = 10000; count <= maxCount; count *= 10) {
+        randomPatients(count, patients);
+        for (STRUCTURE structure : structures) {
+            benchRebuild(structure, patients);
+            benchBulkLoad(structure, patients);
+            benchMoves(structure, count);
+            benchBatch(structure, patients);
+            benchPeek(structure, patients);
+            benchRetriage(structure, patients);
+            benchCancel(structure, patients);
+            benchMergeAll(structure, patients);
+            if (count <= 1000000) {
+                benchSnapshot(structure, patients);
+            }
+            if (structure != DARY) {
+                benchLazyMerge(structure, patients);
+                benchMixed(structure, patients);
+                benchLatency(structure, patients);
+            }
+        }
+        benchBucket(patients);
+        benchPersistent(patients);
+        benchIngest(patients);
+        for (int numThreads = 1; numThreads <= 8; numThreads *= 2) {
+            benchConcurrent(patients, numThreads);
+        }
+    }
+
+    return 0;
+}
+
+int priorityFn1(const Patient & patient) {
+    //this function works with a MAXHEAP
+    //priority value falls in the range [115-242]
+    //temperature + respiratory + blood pressure
+    int priority = patient.getTemperature() + patient.getRR() + patient.getBP();
+    return priority;
+}
+
+int priorityFn2(const Patient & patient) {
+    //this function works with a MINHEAP
+    //priority value falls in the range [71-111]
+    //nurse opinion + oxygen
+    int priority = patient.getOpinion() + patient.getOxygen();
+    return priority;
+}
@@ -0,0 +1,228 @@
+/**********************************************
+ ** File: mystress.cpp
+ ** Project: CMSC 341 Project 3, Fall 2023
+ ** Author: Joshua Hur
+ ** Date: 11/14/23
+ ** Section: 2
+ ** E-mail: jhur1@umbc.edu
+ **
+ ** This file contains the stress tests that insert and drain millions of patients
+ ** in adversarial (sorted) order to make sure no operation of the queue depends on
+ ** the depth of the call stack, and the concurrent queue stress test that runs
+ ** several producer and consumer threads (clean under -fsanitize=thread).
+ ** Every test prints the latency percentiles of its operations.
+ ** Usage: mystress [number of patients], 10000000 by default
+ ** Build with -pthread.
+ ************************************************************************/
+
+#include "pqueue.h"
+#include "concurrentpqueue.h"
+#include "latencyhistogram.h"
+#include "persistentpqueue.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+using namespace std;
+
+// Number of distinct values of each triage parameter
+const int TEMPRANGE = MAXTEMP - MINTEMP + 1;
+const int OXRANGE = MAXOX - MINOX + 1;
+const int RRRANGE = MAXRR - MINRR + 1;
+const int BPRANGE = MAXBP - MINBP + 1;
+const int OPINIONRANGE = MAXOPINION - MINOPINION + 1;
+const long long KEYRANGE = (long long) TEMPRANGE * OXRANGE * RRRANGE * BPRANGE * OPINIONRANGE;
+
+// stressPriority(const Patient& patient)
+// Priority function that gives every combination of triage parameters its own
+// priority, so the stress tests have millions of distinct keys
+int stressPriority(const Patient& patient) {
+    int priority = patient.getTemperature() - MINTEMP;
+    priority = priority * OXRANGE + patient.getOxygen() - MINOX;
+    priority = priority * RRRANGE + patient.getRR() - MINRR;
+    priority = priority * BPRANGE + patient.getBP() - MINBP;
+    priority = priority * OPINIONRANGE + patient.getOpinion() - MINOPINION;
+    return priority;
+}
+
+// sortedPatient(long long i, long long count)
+// Create the i-th of count patients, the stress priorities never decrease as i grows
+Patient sortedPatient(long long i, long long count) {
+    long long key = i * KEYRANGE / count;
+    int op = key % OPINIONRANGE; key /= OPINIONRANGE;
+    int bp = key % BPRANGE; key /= BPRANGE;
+    int rr = key % RRRANGE; key /= RRRANGE;
+    int ox = key % OXRANGE; key /= OXRANGE;
+    int temp = key;
+    return Patient("Sofia Stewart", temp + MINTEMP, ox + MINOX, rr + MINRR,
+                   bp + MINBP, op + MINOPINION);
+}
+
+// stressSorted(STRUCTURE structure, HEAPTYPE heapType, bool ascending, long long count, LatencyRecorder& recorder)
+// Case: Insert count patients in sorted order, then drain the whole queue, recording the latencies
+// Expected result: Return true if every patient comes out in priority order, else return false
+bool stressSorted(STRUCTURE structure, HEAPTYPE heapType, bool ascending, long long count, LatencyRecorder& recorder) {
+    PQueue queue(stressPriority, heapType, structure);
+    queue.reserve(count);
+    queue.setLatencyRecorder(&recorder);
+
+    for (long long i = 0; i < count; i++) {
+        queue.insertPatient(sortedPatient(ascending ? i : count - 1 - i, count));
+    }
+    if (queue.numPatients() != count) {
+        return false;
+    }
+
+    int lastPriority = stressPriority(queue.getNextPatient());
+    while (queue.numPatients() > 0) {
+        int currentPriority = stressPriority(queue.getNextPatient());
+        if ((heapType == MINHEAP && currentPriority < lastPriority) ||
+            (heapType == MAXHEAP && currentPriority > lastPriority)) {
+            return false;
+        }
+        lastPriority = currentPriority;
+    }
+
+    return true;
+}
+
+// stressPersistent(HEAPTYPE heapType, bool ascending, long long count)
+// Case: Insert count patients in sorted order into a persistent queue, keeping a snapshot
+// halfway, drain the queue and then the snapshot, and drop every version
+// Expected result: Return true if both versions come out in priority order with their own
+// sizes and freeing the long spines does not overflow the stack, else return false
+bool stressPersistent(HEAPTYPE heapType, bool ascending, long long count) {
+    PersistentPQueue queue(stressPriority, heapType);
+    PersistentPQueue half(stressPriority, heapType);
+    for (long long i = 0; i < count; i++) {
+        queue.insertPatient(sortedPatient(ascending ? i : count - 1 - i, count));
+        if (i == count / 2) {
+            half = queue.snapshot();
+        }
+    }
+
+    for (PersistentPQueue* version : {&queue, &half}) {
+        long long drained = 0;
+        int lastPriority = stressPriority(version -> getTop());
+        while (version -> numPatients() > 0) {
+            int currentPriority = stressPriority(version -> getNextPatient());
+            if ((heapType == MINHEAP && currentPriority < lastPriority) ||
+                (heapType == MAXHEAP && currentPriority > lastPriority)) {
+                return false;
+            }
+            lastPriority = currentPriority;
+            drained++;
+        }
+        if (drained != (version == &queue ? count : count / 2 + 1)) {
+            return false;
+        }
+    }
+
+    // The snapshot still holds the nodes of its spine, this frees them
+    queue.clear();
+    half.clear();
+    return true;
+}
+
+// stressConcurrent(STRUCTURE structure, int producers, int consumers, long long count, LatencyRecorder& recorder)
+// Case: Producer threads insert count patients while consumer threads dequeue them, recording the latencies
+// Expected result: Return true if the patients dequeued are exactly the patients inserted, else return false
+bool stressConcurrent(STRUCTURE structure, int producers, int consumers, long long count, LatencyRecorder& recorder) {
+    ConcurrentPQueue queue(stressPriority, MINHEAP, structure, 2 * (producers + consumers));
+    queue.setLatencyRecorder(&recorder);
+    atomic<int> producersLeft(producers);
+    vector<vector<int> > dequeued(consumers);
+    vector<thread> threads;
+
+    for (int p = 0; p < producers; p++) {
+        threads.push_back(thread([&, p]() {
+            for (long long i = p; i < count; i += producers) {
+                queue.insertPatient(sortedPatient(i, count));
+            }
+            producersLeft.fetch_sub(1);
+        }));
+    }
+    for (int c = 0; c < consumers; c++) {
+        threads.push_back(thread([&, c]() {
+            Patient patient;
+            while (true) {
+                // Read the flag first, so an empty queue after it means every insert is done
+                bool producing = producersLeft.load() > 0;
+                if (queue.tryGetNextPatient(patient)) {
+                    dequeued[c].push_back(stressPriority(patient));
+                } else if (!producing) {
+                    break;
+                }
+            }
+        }));
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    // Every inserted priority must come out exactly once
+    vector<int> expected, actual;
+    expected.reserve(count);
+    for (long long i = 0; i < count; i++) {
+        expected.push_back(stressPriority(sortedPatient(i, count)));
+    }
+    for (const vector<int>& keys : dequeued) {
+        actual.insert(actual.end(), keys.begin(), keys.end());
+    }
+    sort(actual.begin(), actual.end());
+    return actual == expected && queue.numPatients() == 0;
+}
+
+int main(int argc, char* argv[]) {
+    long long count = 10000000;
+    if (argc > 1) {
+        count = atoll(argv[1]);
+    }
+
+    bool passed = true;
+    const STRUCTURE structures[] = {SKEW, LEFTIST, DARY, PAIRING};
+    const HEAPTYPE heapTypes[] = {MINHEAP, MAXHEAP};
+    const char* const structureNames[] = {"skew", "leftist", "bucket", "d-ary", "pairing"};
+    LatencyRecorder recorder;
+
+    for (STRUCTURE structure : structures) {
+        for (HEAPTYPE heapType : heapTypes) {
+            for (int ascending = 1; ascending >= 0; ascending--) {
+                recorder.reset();
+                bool result = stressSorted(structure, heapType, ascending, count, recorder);
+                passed = passed && result;
+                cout << (result ? "Stress test passed: " : "Stress test failed: ")
+                     << structureNames[structure] << " "
+                     << (heapType == MINHEAP ? "min-heap" : "max-heap") << ", "
+                     << count << " patients in "
+                     << (ascending ? "ascending" : "descending") << " order." << endl
+                     << recorder.report();
+            }
+        }
+    }
+
+    // The persistent queue, whose nodes are freed without recursion
+    for (HEAPTYPE heapType : heapTypes) {
+        for (int ascending = 1; ascending >= 0; ascending--) {
+            bool result = stressPersistent(heapType, ascending, count);
+            passed = passed && result;
+            cout << (result ? "Stress test passed: " : "Stress test failed: ")
+                 << "persistent " << (heapType == MINHEAP ? "min-heap" : "max-heap") << ", "
+                 << count << " patients in "
+                 << (ascending ? "ascending" : "descending") << " order with a snapshot." << endl;
+        }
+    }
+
+    // The concurrent queue with four desks and four clinicians
+    for (STRUCTURE structure : structures) {
+        recorder.reset();
+        bool result = stressConcurrent(structure, 4, 4, count, recorder);
+        passed = passed && result;
+        cout << (result ? "Stress test passed: " : "Stress test failed: ")
+             << "concurrent " << structureNames[structure] << " min-heap, "
+             << count << " patients, 4 producers and 4 consumers." << endl
+             << recorder.report();
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,297 @@
+/**********************************************
+ ** File: mysuite.cpp
+ ** Project: CMSC 341 Project 3, Fall 2023
+ ** Author: Joshua Hur
+ ** Date: 11/14/23
+ ** Section: 2
+ ** E-mail: jhur1@umbc.edu
+ **
+ ** This file contains the benchmark suite that guards against performance regressions.
+ ** It times insertPatient, getNextPatient, mergeWithQueue, the setPriorityFn and
+ ** setStructure rebuilds and the copy constructor for every combination of SKEW/LEFTIST,
+ ** MINHEAP/MAXHEAP and input order, at sizes from 1e3 patients up to a maximum size.
+ ** Every measurement is one machine-readable row (CSV, or JSON with --json) with the
+ ** operations per second, nanoseconds per operation and the peak resident set size.
+ ** Usage: mysuite [maximum number of patients] [--json], 10000000 by default
+ ************************************************************************/
+
+#include "pqueue.h"
+#include "random.h"
+#include <sys/resource.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+using namespace std;
+
+int priorityFn1(const Patient & patient);
+int priorityFn2(const Patient & patient);
+
+// Input orders of the patients: the three Random distributions, then the uniform
+// patients sorted with the highest priority first, and the reverse of that
+enum ORDER {UNIFORMORDER, NORMALORDER, SHUFFLEORDER, SORTEDORDER, ADVERSARIALORDER};
+const char* const ORDERNAMES[] = {"uniform", "normal", "shuffle", "sorted", "adversarial"};
+const char* const STRUCTURENAMES[] = {"skew", "leftist", "bucket", "dary", "pairing"};
+const char* const HEAPNAMES[] = {"minheap", "maxheap"};
+const int NUMREGIONS = 64;  // queues folded together by the merge measurement
+
+// One row of the results
+struct Measurement {
+    const char* m_operation;
+    STRUCTURE m_structure;
+    HEAPTYPE m_heapType;
+    ORDER m_order;
+    int m_patients;
+    long long m_ops;
+    double m_seconds;
+    long m_peakKB;
+};
+
+// resetPeakRSS()
+// Start a new peak resident set size measurement. Linux lowers the high-water mark to the
+// current size when 5 is written to clear_refs; elsewhere the peak of the whole run is kept
+void resetPeakRSS() {
+    ofstream clearRefs("/proc/self/clear_refs");
+    if (clearRefs) {
+        clearRefs << "5";
+    }
+}
+
+// peakRSS()
+// Return the peak resident set size in KB since the last reset
+long peakRSS() {
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return atol(line.c_str() + 6);
+        }
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// secondsSince(chrono::steady_clock::time_point start)
+// Return the seconds elapsed since start
+double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// printMeasurement(const Measurement& row, bool json, bool first)
+// Print one row as CSV, or as an element of the JSON array
+void printMeasurement(const Measurement& row, bool json, bool first) {
+    double opsPerSecond = row.m_ops / row.m_seconds;
+    double nsPerOp = row.m_seconds * 1e9 / row.m_ops;
+    if (json) {
+        printf("%s{\"operation\": \"%s\", \"structure\": \"%s\", \"heap\": \"%s\", \"order\": \"%s\", "
+               "\"patients\": %d, \"ops\": %lld, \"seconds\": %.6f, \"ops_per_sec\": %.1f, "
+               "\"ns_per_op\": %.1f, \"peak_rss_kb\": %ld}",
+               first ? "[\n  " : ",\n  ", row.m_operation, STRUCTURENAMES[row.m_structure],
+               HEAPNAMES[row.m_heapType], ORDERNAMES[row.m_order], row.m_patients, row.m_ops,
+               row.m_seconds, opsPerSecond, nsPerOp, row.m_peakKB);
+    } else {
+        if (first) {
+            printf("operation,structure,heap,order,patients,ops,seconds,ops_per_sec,ns_per_op,peak_rss_kb\n");
+        }
+        printf("%s,%s,%s,%s,%d,%lld,%.6f,%.1f,%.1f,%ld\n", row.m_operation, STRUCTURENAMES[row.m_structure],
+               HEAPNAMES[row.m_heapType], ORDERNAMES[row.m_order], row.m_patients, row.m_ops,
+               row.m_seconds, opsPerSecond, nsPerOp, row.m_peakKB);
+    }
+    fflush(stdout);
+}
+
+// makePatients(int count, ORDER order, vector<Patient>& patients)
+// Fill the vector with count patients drawn by the Random class. Every generator has its own
+// fixed seed, so the runs are repeatable. The sorted orders start from the uniform patients
+void makePatients(int count, ORDER order, vector<Patient>& patients) {
+    const int minimum[5] = {MINTEMP, MINOX, MINRR, MINBP, MINOPINION};
+    const int maximum[5] = {MAXTEMP, MAXOX, MAXRR, MAXBP, MAXOPINION};
+    patients.clear();
+    patients.reserve(count);
+
+    if (order == SHUFFLEORDER) {
+        // Every vital cycles through its whole range, so each priority is equally common,
+        // and the patients arrive in a shuffled order
+        vector<int> indices;
+        Random shuffler(0, count - 1, SHUFFLE);
+        shuffler.setSeed(10);
+        shuffler.getShuffle(indices);
+        for (int index : indices) {
+            int vitals[5];
+            int rest = index;
+            for (int vital = 0; vital < 5; vital++) {
+                int width = maximum[vital] - minimum[vital] + 1;
+                vitals[vital] = minimum[vital] + rest % width;
+                rest /= width;
+            }
+            patients.push_back(Patient("Erika Drake", vitals[0], vitals[1], vitals[2], vitals[3], vitals[4]));
+        }
+        return;
+    }
+
+    // A bell curve around the middle of each range for NORMAL, else uniform
+    RANDOM type = (order == NORMALORDER) ? NORMAL : UNIFORMINT;
+    Random temperatureGen(MINTEMP, MAXTEMP, type, (MINTEMP + MAXTEMP) / 2, 2);
+    Random oxygenGen(MINOX, MAXOX, type, (MINOX + MAXOX) / 2, 8);
+    Random respiratoryGen(MINRR, MAXRR, type, (MINRR + MAXRR) / 2, 8);
+    Random bloodPressureGen(MINBP, MAXBP, type, (MINBP + MAXBP) / 2, 22);
+    Random nurseOpinionGen(MINOPINION, MAXOPINION, type, (MINOPINION + MAXOPINION) / 2, 2);
+    temperatureGen.setSeed(10);
+    oxygenGen.setSeed(11);
+    respiratoryGen.setSeed(12);
+    bloodPressureGen.setSeed(13);
+    nurseOpinionGen.setSeed(14);
+    for (int i = 0; i < count; i++) {
+        int vitals[5] = {temperatureGen.getRandNum(), oxygenGen.getRandNum(), respiratoryGen.getRandNum(),
+                         bloodPressureGen.getRandNum(), nurseOpinionGen.getRandNum()};
+        patients.push_back(Patient("Erika Drake", vitals[0], vitals[1], vitals[2], vitals[3], vitals[4]));
+    }
+}
+
+// sortPatients(vector<Patient>& patients, HEAPTYPE heapType, prifn_t priFn, bool adversarial)
+// Sort the patients with the highest priority first, or last for the adversarial order,
+// where every insert becomes the new root
+void sortPatients(vector<Patient>& patients, HEAPTYPE heapType, prifn_t priFn, bool adversarial) {
+    bool ascending = (heapType == MINHEAP) != adversarial;
+    stable_sort(patients.begin(), patients.end(), [priFn, ascending](const Patient& a, const Patient& b) {
+        return ascending ? priFn(a) < priFn(b) : priFn(a) > priFn(b);
+    });
+}
+
+// runCase(STRUCTURE structure, HEAPTYPE heapType, ORDER order, const vector<Patient>& patients,
+//         vector<Measurement>& rows)
+// Time every operation for one combination. The rebuilds run on the copy, so the drain
+// measures the queue as it was built
+void runCase(STRUCTURE structure, HEAPTYPE heapType, ORDER order, const vector<Patient>& patients,
+             vector<Measurement>& rows) {
+    int count = patients.size();
+    prifn_t priFn = (heapType == MINHEAP) ? priorityFn2 : priorityFn1;
+    Measurement row = {"", structure, heapType, order, count, count, 0, 0};
+
+    PQueue queue(priFn, heapType, structure);
+    resetPeakRSS();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (const Patient& patient : patients) {
+        queue.insertPatient(patient);
+    }
+    row.m_seconds = secondsSince(start);
+    row.m_operation = "insertPatient";
+    row.m_peakKB = peakRSS();
+    rows.push_back(row);
+
+    {
+        resetPeakRSS();
+        start = chrono::steady_clock::now();
+        PQueue copiedQueue(queue);
+        row.m_seconds = secondsSince(start);
+        row.m_operation = "copy";
+        row.m_peakKB = peakRSS();
+        rows.push_back(row);
+
+        resetPeakRSS();
+        start = chrono::steady_clock::now();
+        copiedQueue.setPriorityFn(heapType == MINHEAP ? priorityFn1 : priorityFn2,
+                                  heapType == MINHEAP ? MAXHEAP : MINHEAP);
+        row.m_seconds = secondsSince(start);
+        row.m_operation = "setPriorityFn";
+        row.m_peakKB = peakRSS();
+        rows.push_back(row);
+
+        resetPeakRSS();
+        start = chrono::steady_clock::now();
+        copiedQueue.setStructure(structure == SKEW ? LEFTIST : SKEW);
+        row.m_seconds = secondsSince(start);
+        row.m_operation = "setStructure";
+        row.m_peakKB = peakRSS();
+        rows.push_back(row);
+    }
+
+    resetPeakRSS();
+    start = chrono::steady_clock::now();
+    while (queue.numPatients() > 0) {
+        queue.getNextPatient();
+    }
+    row.m_seconds = secondsSince(start);
+    row.m_operation = "getNextPatient";
+    row.m_peakKB = peakRSS();
+    rows.push_back(row);
+
+    // NUMREGIONS queues of the same patients folded one after another
+    vector<PQueue> regions;
+    for (int region = 0; region < NUMREGIONS; region++) {
+        regions.emplace_back(priFn, heapType, structure);
+    }
+    for (int i = 0; i < count; i++) {
+        regions[i % NUMREGIONS].insertPatient(patients[i]);
+    }
+    resetPeakRSS();
+    start = chrono::steady_clock::now();
+    for (int region = 1; region < NUMREGIONS; region++) {
+        regions[0].mergeWithQueue(regions[region]);
+    }
+    row.m_seconds = secondsSince(start);
+    row.m_operation = "mergeWithQueue";
+    row.m_ops = NUMREGIONS - 1;
+    row.m_peakKB = peakRSS();
+    rows.push_back(row);
+}
+
+int main(int argc, char* argv[]) {
+    int maxCount = 10000000;
+    bool json = false;
+    for (int arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "--json") == 0) {
+            json = true;
+        } else {
+            maxCount = atoi(argv[arg]);
+        }
+    }
+
+    const STRUCTURE structures[] = {SKEW, LEFTIST};
+    const HEAPTYPE heapTypes[] = {MINHEAP, MAXHEAP};
+    const ORDER orders[] = {UNIFORMORDER, NORMALORDER, SHUFFLEORDER, SORTEDORDER, ADVERSARIALORDER};
+    bool first = true;
+    vector<Patient> patients;
+    for (int count = 1000; count <= maxCount; count *= 10) {
+        for (ORDER order : orders) {
+            for (HEAPTYPE heapType : heapTypes) {
+                makePatients(count, order == SORTEDORDER || order == ADVERSARIALORDER ? UNIFORMORDER : order, patients);
+                if (order == SORTEDORDER || order == ADVERSARIALORDER) {
+                    sortPatients(patients, heapType, heapType == MINHEAP ? priorityFn2 : priorityFn1,
+                                 order == ADVERSARIALORDER);
+                }
+                for (STRUCTURE structure : structures) {
+                    vector<Measurement> rows;
+                    runCase(structure, heapType, order, patients, rows);
+                    for (const Measurement& row : rows) {
+                        printMeasurement(row, json, first);
+                        first = false;
+                    }
+                }
+            }
+        }
+    }
+    if (json) {
+        printf(first ? "[]\n" : "\n]\n");
+    }
+
+    return 0;
+}
+
+int priorityFn1(const Patient & patient) {
+    //this function works with a MAXHEAP
+    //priority value falls in the range [115-242]
+    //temperature + respiratory + blood pressure
+    int priority = patient.getTemperature() + patient.getRR() + patient.getBP();
+    return priority;
+}
+
+int priorityFn2(const Patient & patient) {
+    //this function works with a MINHEAP
+    //priority value falls in the range [71-111]
+    //nurse opinion + oxygen
+    int priority = patient.getOpinion() + patient.getOxygen();
+    return priority;
+}
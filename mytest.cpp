@@ -10,9 +10,18 @@
  ************************************************************************/
 
 #include "pqueue.h"
+#include "concurrentpqueue.h"
+#include "patientfeed.h"
+#include "latencyhistogram.h"
+#include "persistentpqueue.h"
+#include "random.h"
 #include <math.h>
 #include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include <random>
+#include <set>
+#include <thread>
 #include <vector>
 using namespace std;
 
@@ -32,115 +41,26 @@ string nameDB[NUMNAMES] = {
     "Erika Drake", "Libby Russo", "Liam Taylor", "Sofia Stewart"
 };
 
-// We can use the Random class to generate the test data randomly!
-enum RANDOM {UNIFORMINT, UNIFORMREAL, NORMAL, SHUFFLE};
-class Random {
-public:
-    Random(int min, int max, RANDOM type=UNIFORMINT, int mean=50, int stdev=20) : m_min(min), m_max(max), m_type(type)
-    {
-        if (type == NORMAL){
-            //the case of NORMAL to generate integer numbers with normal distribution
-            m_generator = std::mt19937(m_device());
-            //the data set will have the mean of 50 (default) and standard deviation of 20 (default)
-            //the mean and standard deviation can change by passing new values to constructor
-            m_normdist = std::normal_distribution<>(mean,stdev);
-        }
-        else if (type == UNIFORMINT) {
-            //the case of UNIFORMINT to generate integer numbers
-            // Using a fixed seed value generates always the same sequence
-            // of pseudorandom numbers, e.g. reproducing scientific experiments
-            // here it helps us with testing since the same sequence repeats
-            m_generator = std::mt19937(10);// 10 is the fixed seed value
-            m_unidist = std::uniform_int_distribution<>(min,max);
-        }
-        else if (type == UNIFORMREAL) { //the case of UNIFORMREAL to generate real numbers
-            m_generator = std::mt19937(10);// 10 is the fixed seed value
-            m_uniReal = std::uniform_real_distribution<double>((double)min,(double)max);
-        }
-        else { //the case of SHUFFLE to generate every number only once
-            m_generator = std::mt19937(m_device());
-        }
-    }
-    void setSeed(int seedNum){
-        // we have set a default value for seed in constructor
-        // we can change the seed by calling this function after constructor call
-        // this gives us more randomness
-        m_generator = std::mt19937(seedNum);
-    }
-
-    void getShuffle(vector<int> & array){
-        // the user program creates the vector param and passes here
-        // here we populate the vector using m_min and m_max
-        for (int i = m_min; i<=m_max; i++){
-            array.push_back(i);
-        }
-        shuffle(array.begin(),array.end(),m_generator);
-    }
-
-    void getShuffle(int array[]){
-        // the param array must be of the size (m_max-m_min+1)
-        // the user program creates the array and pass it here
-        vector<int> temp;
-        for (int i = m_min; i<=m_max; i++){
-            temp.push_back(i);
-        }
-        std::shuffle(temp.begin(), temp.end(), m_generator);
-        vector<int>::iterator it;
-        int i = 0;
-        for (it=temp.begin(); it != temp.end(); it++){
-            array[i] = *it;
-            i++;
-        }
-    }
-
-    int getRandNum(){
-        // this function returns integer numbers
-        // the object must have been initialized to generate integers
-        int result = 0;
-        if(m_type == NORMAL){
-            //returns a random number in a set with normal distribution
-            //we limit random numbers by the min and max values
-            result = m_min - 1;
-            while(result < m_min || result > m_max)
-                result = m_normdist(m_generator);
-        }
-        else if (m_type == UNIFORMINT){
-            //this will generate a random number between min and max values
-            result = m_unidist(m_generator);
-        }
-        return result;
-    }
-
-    double getRealRandNum(){
-        // this function returns real numbers
-        // the object must have been initialized to generate real numbers
-        double result = m_uniReal(m_generator);
-        // a trick to return numbers only with two deciaml points
-        // for example if result is 15.0378, function returns 15.03
-        // to round up we can use ceil function instead of floor
-        result = std::floor(result*100.0)/100.0;
-        return result;
-    }
-    
-    private:
-    int m_min;
-    int m_max;
-    RANDOM m_type;
-    std::random_device m_device;
-    std::mt19937 m_generator;
-    std::normal_distribution<> m_normdist;//normal distribution
-    std::uniform_int_distribution<> m_unidist;//integer uniform distribution
-    std::uniform_real_distribution<double> m_uniReal;//real uniform distribution
-
-};
-
 class Tester{
     public:
     
+    // makeQueue(prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure, int minKey, int maxKey)
+    // Helper function of the tests that run on every structure: a bucket queue gets the key
+    // range [minKey, maxKey], the keys of priFn outside it overflow
+    PQueue makeQueue(prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure, int minKey = 80, int maxKey = 100) {
+        if (structure == BUCKET) {
+            return PQueue(priFn, heapType, minKey, maxKey);
+        }
+        return PQueue(priFn, heapType, structure);
+    }
+    
     // testMinHeap(PQueue& queue)
     // Case: Verify min-heap property of the heap
     // Expected result: Return true if the min-heap property is satisfied at every node, else return false
     bool testMinHeap(PQueue& queue) {
+        if (queue.getStructure() == PAIRING) {
+            return pairingHeapProperty(queue);
+        }
         return minHeapProperty(queue.getRoot(), queue.getPriorityFn());
     }
     
@@ -160,6 +80,9 @@ class Tester{
     // Case: Verify max-heap property of the heap
     // Expected result: Return true if the max-heap property is satisfied at every node, else return false
     bool testMaxHeap(PQueue &queue) {
+        if (queue.getStructure() == PAIRING) {
+            return pairingHeapProperty(queue);
+        }
         
         return maxHeapProperty(queue.getRoot(), queue.getPriorityFn());
     }
@@ -176,6 +99,65 @@ class Tester{
         return left && right;
     }
     
+    // pairingHeapProperty(PQueue& queue)
+    // Helper function of testMinHeap and testMaxHeap for pairing heaps, where m_left is the first child
+    // and m_right the next sibling; an explicit stack visits the long sibling lists without recursion
+    bool pairingHeapProperty(PQueue& queue) {
+        Node* root = queue.getRoot();
+        if (!root) return true;
+        if (root -> m_right) return false;
+        
+        vector<Node*> stack(1, root);
+        while (!stack.empty()) {
+            Node* node = stack.back();
+            stack.pop_back();
+            for (Node* child = node -> m_left; child; child = child -> m_right) {
+                if (queue.isHigher(child, node)) {
+                    return false;
+                }
+                stack.push_back(child);
+            }
+        }
+        return true;
+    }
+    
+    // testPairingHeap(const vector<Patient>& patients)
+    // Case: Verify a pairing heap keeps its property through inserts, merges, conversions and removals
+    // Expected result: Return true if every step keeps the heap property and the queue drains in priority order, else return false
+    bool testPairingHeap(const vector<Patient>& patients) {
+        PQueue queue(priorityFn2, MINHEAP, PAIRING);
+        PQueue otherQueue(patients.begin(), patients.end(), priorityFn2, MINHEAP, PAIRING);
+        for (const Patient& patient : patients) {
+            queue.insertPatient(patient);
+        }
+        queue.mergeWithQueue(otherQueue);
+        if (queue.numPatients() != 2 * (int) patients.size() || otherQueue.numPatients() != 0 ||
+            !testMinHeap(queue)) {
+            return false;
+        }
+        
+        // A copy converted to a leftist heap and back must drain like the original
+        PQueue copiedQueue(queue);
+        copiedQueue.setStructure(LEFTIST);
+        if (!testMinHeap(copiedQueue) || !testLeftistProperty(copiedQueue)) {
+            return false;
+        }
+        copiedQueue.setStructure(PAIRING);
+        queue.setPriorityFn(priorityFn1, MAXHEAP);
+        copiedQueue.setPriorityFn(priorityFn1, MAXHEAP);
+        
+        while (queue.numPatients() > 0) {
+            int priority = priorityFn1(queue.getNextPatient());
+            if (priority != priorityFn1(copiedQueue.getNextPatient())) {
+                return false;
+            }
+            if (queue.numPatients() % 97 == 0 && !testMaxHeap(queue)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
     // testMinHeapRemoval(PQueue& queue)
     // Case: Check if remove the heap happen in the correct order
     // Expected result: Return true if all removals happen in the min-heap property, else return false
@@ -430,155 +412,1545 @@ class Tester{
             return true;
         }
     }
-};
-
-int main(){
-    Tester tester;
-    
-    Random nameGen(0,NUMNAMES-1);
-    Random temperatureGen(MINTEMP,MAXTEMP);
-    Random oxygenGen(MINOX,MAXOX);
-    Random respiratoryGen(MINRR,MAXRR);
-    Random bloodPressureGen(MINBP,MAXBP);
-    Random nurseOpinionGen(MINOPINION,MAXOPINION);
-    
-    PQueue minHeapQueue(priorityFn2, MINHEAP, LEFTIST);
-    PQueue maxHeapQueue(priorityFn1, MAXHEAP, LEFTIST);
-    for (int i = 0; i < 300; i++){
-        Patient patient(nameDB[nameGen.getRandNum()],
-                    temperatureGen.getRandNum(),
-                    oxygenGen.getRandNum(),
-                    respiratoryGen.getRandNum(),
-                    bloodPressureGen.getRandNum(),
-                    nurseOpinionGen.getRandNum());
-        minHeapQueue.insertPatient(patient);
-        maxHeapQueue.insertPatient(patient);
-    }
     
-    //minHeapQueue.dump();
-    if (tester.testMinHeap(minHeapQueue)){
-        cout << "Min-Heap test is passed!" << endl;
-    } else {
-        cout << "Min-Heap test is failed!" << endl;
+    // testCachedKeys(PQueue& queue)
+    // Case: Verify every node caches the priority computed by the current priority function
+    // Expected result: Return true if the cached key of every node matches the priority function, else return false
+    bool testCachedKeys(PQueue& queue) {
+        return cachedKeysHelper(queue.getRoot(), queue.getPriorityFn());
     }
     
-    //maxHeapQueue.dump();
-    if (tester.testMaxHeap(maxHeapQueue)){
-        cout << "Max-Heap test is passed!" << endl;
-    } else {
-        cout << "Max-Heap test is failed!" << endl;
+    // cachedKeysHelper(Node* node, prifn_t priFn)
+    // Recursive helper function of testCachedKeys(PQueue& queue) that compares each cached key with the priority function
+    bool cachedKeysHelper(Node* node, prifn_t priFn) {
+        if (!node) return true;
+        
+        return node -> getKey() == priFn(node -> m_patient) &&
+               cachedKeysHelper(node -> m_left, priFn) &&
+               cachedKeysHelper(node -> m_right, priFn);
     }
     
-    PQueue minHeapQueueRemove(priorityFn2, MINHEAP, LEFTIST);
-    PQueue maxHeapQueueRemove(priorityFn1, MAXHEAP, LEFTIST);
-    for (int i = 0; i < 300; i++){
-        Patient patient(nameDB[nameGen.getRandNum()],
-                    temperatureGen.getRandNum(),
-                    oxygenGen.getRandNum(),
-                    respiratoryGen.getRandNum(),
-                    bloodPressureGen.getRandNum(),
-                    nurseOpinionGen.getRandNum());
-        minHeapQueueRemove.insertPatient(patient);
-        maxHeapQueueRemove.insertPatient(patient);
+    // testSetStructure(PQueue& queue)
+    // Case: Verify a skew heap converted to a leftist heap is rebuilt with all its patients
+    // Expected result: Return true if the rebuilt heap keeps its size, the heap property, the NPL values and the leftist property, else return false
+    bool testSetStructure(PQueue& queue) {
+        int sizeBefore = queue.numPatients();
+        queue.setStructure(LEFTIST);
+        
+        if (queue.getStructure() != LEFTIST || queue.numPatients() != sizeBefore) {
+            return false;
+        }
+        
+        bool isHeap = (queue.getHeapType() == MINHEAP) ? testMinHeap(queue) : testMaxHeap(queue);
+        return isHeap && testNPLValues(queue) && testLeftistProperty(queue);
     }
     
-    if (tester.testMinHeapRemoval(minHeapQueueRemove)) {
-        cout << "Test passed: Min-Heap removal is correct." << endl;
-    } else {
-        cout << "Test failed: Removal order is incorrect." << endl;
-    };
-    
-    if (tester.testMaxHeapRemoval(maxHeapQueueRemove)){
-        cout << "Test passed: Max-Heap removal is correct." << endl;
-    } else {
-        cout << "Test failed: Removal order is incorrect." << endl;
+    // testBulkLoad(const vector<Patient>& patients, STRUCTURE structure, HEAPTYPE heapType, prifn_t priFn)
+    // Case: Verify a queue built from a range of patients, then topped up with the same range, is a valid heap
+    // Expected result: Return true if the queue holds every patient and keeps the heap property, the NPL values and the leftist property, else return false
+    bool testBulkLoad(const vector<Patient>& patients, STRUCTURE structure, HEAPTYPE heapType, prifn_t priFn) {
+        PQueue queue(patients.begin(), patients.end(), priFn, heapType, structure);
+        if (queue.numPatients() != (int) patients.size()) {
+            return false;
+        }
+        
+        queue.insertPatients(patients.begin(), patients.end());
+        if (queue.numPatients() != 2 * (int) patients.size()) {
+            return false;
+        }
+        
+        bool isHeap = (heapType == MINHEAP) ? testMinHeap(queue) : testMaxHeap(queue);
+        if (structure == LEFTIST) {
+            return isHeap && testNPLValues(queue) && testLeftistProperty(queue);
+        }
+        return isHeap;
     }
     
-    PQueue leftistHeapOne(priorityFn2, MINHEAP, LEFTIST);
-    PQueue leftistHeapTwo(priorityFn2, MINHEAP, LEFTIST);
-    PQueue TreeOne(priorityFn2, MINHEAP, LEFTIST);
-
-    for (int i = 0; i < 5; i++){
-        Patient patient(nameDB[nameGen.getRandNum()],
-                    temperatureGen.getRandNum(),
-                    oxygenGen.getRandNum(),
-                    respiratoryGen.getRandNum(),
-                    bloodPressureGen.getRandNum(),
-                    nurseOpinionGen.getRandNum());
-        leftistHeapOne.insertPatient(patient);
-        leftistHeapTwo.insertPatient(patient);
-        TreeOne.insertPatient(patient);
+    // testMoveSemantics(PQueue& queue)
+    // Case: Verify moving a queue steals its heap and moved or emplaced patients are stored intact
+    // Expected result: Return true if the moved-to queue has every patient, the moved-from queue is empty and patients come out unchanged, else return false
+    bool testMoveSemantics(PQueue& queue) {
+        int size = queue.numPatients();
+        Node* root = queue.getRoot();
+        
+        PQueue movedQueue(move(queue));
+        if (movedQueue.getRoot() != root || movedQueue.numPatients() != size ||
+            queue.getRoot() != nullptr || queue.numPatients() != 0) {
+            return false;
+        }
+        
+        queue = move(movedQueue);
+        if (queue.getRoot() != root || queue.numPatients() != size || movedQueue.numPatients() != 0) {
+            return false;
+        }
+        
+        // Moved and emplaced patients come out of the queue unchanged
+        PQueue smallQueue(queue.getPriorityFn(), queue.getHeapType(), queue.getStructure());
+        Patient urgent("Aliyah Strong", 39, 70, 30, 150, 1);
+        Patient copy = urgent;
+        smallQueue.insertPatient(move(urgent));
+        if (!(smallQueue.getNextPatient() == copy)) {
+            return false;
+        }
+        
+        smallQueue.emplacePatient("Beatrix Acosta", 39, 70, 30, 150, 1);
+        Patient emplaced = smallQueue.getNextPatient();
+        return emplaced.getPatient() == "Beatrix Acosta" && smallQueue.numPatients() == 0;
     }
-     
-    //TreeOne.dump();
     
-    if (tester.testNPLValues(leftistHeapOne)) {
-        cout << "Test passed: All nodes in a leftist heap have the correct NPL values." << endl;
-    } else {
-        cout << "Test failed: Not every nodes in a leftist heap have the correct NPL values." << endl;
+    // testCompactPatient()
+    // Case: Verify the compact patient record keeps every triage parameter and the name through the getters and setters
+    // Expected result: Return true if the values read back match, long names are cut to MAXNAME characters and a byte copy equals the original, else return false
+    bool testCompactPatient() {
+        Patient patient("Grace Mclaughlin", MAXTEMP, MAXOX, MAXRR, MAXBP, MAXOPINION);
+        if (patient.getPatient() != "Grace Mclaughlin" || patient.getTemperature() != MAXTEMP ||
+            patient.getOxygen() != MAXOX || patient.getRR() != MAXRR ||
+            patient.getBP() != MAXBP || patient.getOpinion() != MAXOPINION) {
+            return false;
+        }
+        
+        patient.setTemperature(MINTEMP);
+        patient.setOxygen(MINOX);
+        patient.setRR(MINRR);
+        patient.setBP(MINBP);
+        patient.setOpinion(MINOPINION);
+        if (patient.getTemperature() != MINTEMP || patient.getOxygen() != MINOX ||
+            patient.getRR() != MINRR || patient.getBP() != MINBP || patient.getOpinion() != MINOPINION) {
+            return false;
+        }
+        
+        // Values outside the triage ranges don't fit a byte and leave the record as it was
+        patient.setTemperature(-1);
+        patient.setOxygen(MAXOX + 1);
+        patient.setRR(MINRR - 1);
+        patient.setBP(300);
+        patient.setOpinion(MAXOPINION + 1);
+        if (patient.getTemperature() != MINTEMP || patient.getOxygen() != MINOX ||
+            patient.getRR() != MINRR || patient.getBP() != MINBP || patient.getOpinion() != MINOPINION) {
+            return false;
+        }
+        
+        // A name longer than the inline buffer is cut, a shorter name leaves no trace of it
+        string longName(MAXNAME + 10, 'x');
+        patient.setPatient(longName);
+        if (patient.getPatient() != longName.substr(0, MAXNAME)) {
+            return false;
+        }
+        patient.setPatient("Libby Russo");
+        
+        Patient copy;
+        memcpy(&copy, &patient, sizeof(Patient));
+        Patient same("Libby Russo", MINTEMP, MINOX, MINRR, MINBP, MINOPINION);
+        return copy == patient && same == patient && copy.getPatient() == "Libby Russo";
     }
     
-    if (tester.testNPLValues(leftistHeapTwo)) {
-        cout << "Test passed: Leftist heap property is maintained!" << endl;
-    } else {
-        cout << "Test failed: Not every node the NPL value of the left child is greater than or equal to the NPL value of the right child!" << endl;
-    }
-
-    TreeOne.setPriorityFn(priorityFn1, MAXHEAP);
-    if (tester.testPriorityFunction(TreeOne)) {
-        cout << "Test Passed: Heap rebuilt correctly with new priority function." << endl;
-    } else {
-        cout << "Test Failed: Heap not rebuilt correctly with new priority function." << endl;
+    // testLongRightSpine(PQueue& queueOne, PQueue& queueTwo, int length)
+    // Case: Verify merging and copying skew heaps whose right spines are far deeper than the call stack allows
+    // Expected result: Return true if the merged heap and its copy keep every patient in min-heap order, else return false
+    bool testLongRightSpine(PQueue& queueOne, PQueue& queueTwo, int length) {
+        
+        // Build two right spines with interleaved priorities so merge has to walk both of them
+        buildRightSpine(queueOne, length, 0);
+        buildRightSpine(queueTwo, length, 1);
+        queueOne.mergeWithQueue(queueTwo);
+        if (queueOne.numPatients() != 2 * length || queueTwo.numPatients() != 0) {
+            return false;
+        }
+        
+        PQueue copiedQueue(queueOne);
+        if (copiedQueue.numPatients() != queueOne.numPatients()) {
+            return false;
+        }
+        
+        int lastKey = -1;
+        while (copiedQueue.numPatients() > 0) {
+            int currentKey = copiedQueue.getRoot() -> getKey();
+            copiedQueue.getNextPatient();
+            if (currentKey < lastKey) {
+                return false;
+            }
+            lastKey = currentKey;
+        }
+        
+        return true;
     }
     
-    PQueue emptyQueue(priorityFn2, MINHEAP, LEFTIST);
-    PQueue populatedQueue(priorityFn2, MINHEAP, LEFTIST);
-    
-    PQueue queueOne(priorityFn2, MINHEAP, LEFTIST);
-    PQueue queueTwo(priorityFn2, MINHEAP, LEFTIST);
-
-    for (int i = 0; i < 10; i++){
-        Patient patient(nameDB[nameGen.getRandNum()],
-                    temperatureGen.getRandNum(),
-                    oxygenGen.getRandNum(),
-                    respiratoryGen.getRandNum(),
-                    bloodPressureGen.getRandNum(),
-                    nurseOpinionGen.getRandNum());
-        populatedQueue.insertPatient(patient);
-        queueOne.insertPatient(patient);
+    // buildRightSpine(PQueue& queue, int length, int offset)
+    // Helper function of testLongRightSpine that links a min-heap with keys offset, offset + 2, ... along the right spine
+    void buildRightSpine(PQueue& queue, int length, int offset) {
+        Patient patient("Tyler Dunn", 37, 95, 20, 110, 5);
+        Node* last = nullptr;
+        
+        for (int i = 0; i < length; i++) {
+            Node* node = queue.m_pool.allocate(patient);
+            node -> m_key = queue.packKey(offset + 2 * i, i);
+            if (last) {
+                last -> m_right = node;
+            } else {
+                queue.m_heap = node;
+            }
+            last = node;
+        }
+        queue.m_size = length;
     }
     
-    if (tester.testMergeEmptyQueue(emptyQueue, populatedQueue)) {
-        cout << "Test Passed: Merge with empty queue successful." << endl;
+    // testNodePoolRecycle(PQueue& queue, int count)
+    // Case: Verify the node pool recycles dequeued nodes and reserve() pre-sizes the pool
+    // Expected result: Return true if refilling a drained queue and filling a reserved queue never grow the pool, else return false
+    bool testNodePoolRecycle(PQueue& queue, int count) {
+        Patient patient("Liam Taylor", 38, 90, 25, 120, 3);
         
-    } else {
-        cout << "Test Failed: Merge with empty queue unsuccessful." << endl;
+        queue.reserve(count);
+        int reserved = queue.m_pool.capacity();
+        if (reserved < count) {
+            return false;
+        }
+        
+        for (int i = 0; i < count; i++) {
+            queue.insertPatient(patient);
+        }
+        while (queue.numPatients() > 0) {
+            queue.getNextPatient();
+        }
+        for (int i = 0; i < count; i++) {
+            queue.insertPatient(patient);
+        }
+        
+        // Every node of the second round must come from the free list
+        if (queue.m_pool.capacity() != reserved) {
+            return false;
+        }
+        
+        // clear() releases every slab at once
+        queue.clear();
+        return queue.m_pool.capacity() == 0 && queue.numPatients() == 0;
     }
     
-    PQueue queueThree(priorityFn2, MINHEAP, LEFTIST);
-    for (int i = 0; i < 10; i++){
-        Patient patient(nameDB[nameGen.getRandNum()],
-                    temperatureGen.getRandNum(),
-                    oxygenGen.getRandNum(),
-                    respiratoryGen.getRandNum(),
-                    bloodPressureGen.getRandNum(),
-                    nurseOpinionGen.getRandNum());
+    // testDaryProperty(PQueue& queue)
+    // Case: Verify every entry of a d-ary heap has no higher priority than its parent
+    // Expected result: Return true if the heap property holds, every cached key is current and every node knows its index, else return false
+    bool testDaryProperty(PQueue& queue) {
+        const vector<PQueue::DaryEntry>& heap = queue.m_dary;
+        if ((int) heap.size() != queue.numPatients() + queue.numDead()) {
+            return false;
+        }
         
-        queueThree.insertPatient(patient);
+        for (int index = 0; index < (int) heap.size(); index++) {
+            if (heap[index].key != heap[index].node -> m_key ||
+                heap[index].node -> getKey() != queue.getPriorityFn()(heap[index].node -> m_patient) ||
+                heap[index].node -> m_npl != index) {
+                return false;
+            }
+            
+            int parent = (index - 1) / queue.getArity();
+            if (index > 0 && queue.isHigherKey(heap[index].key, heap[parent].key)) {
+                return false;
+            }
+        }
+        return true;
     }
     
-    PQueue queueFour(queueThree);
-    if (tester.testCopyConstructorEdge(queueThree, queueFour)){
-        cout << "Normal Test Passed: The copy constructor successfully makes a deep copy." << endl;
-    } else {
-        cout << "Normal Test Passed: The copy constructor fail to make a deep copy." << endl;
+    // testDaryHeap(const vector<Patient>& patients, int arity)
+    // Case: Verify a d-ary heap keeps its property through bulk loads, inserts, merges and conversions
+    // Expected result: Return true if every step keeps the d-ary heap property and the queue drains in priority order, else return false
+    bool testDaryHeap(const vector<Patient>& patients, int arity) {
+        PQueue queue(priorityFn2, MINHEAP, DARY);
+        queue.setArity(arity);
+        queue.insertPatients(patients.begin(), patients.end());
+        for (const Patient& patient : patients) {
+            queue.insertPatient(patient);
+        }
+        if (!testDaryProperty(queue)) {
+            return false;
+        }
+        
+        PQueue otherQueue(patients.begin(), patients.end(), priorityFn2, MINHEAP, DARY);
+        otherQueue.setArity(arity);
+        queue.mergeWithQueue(otherQueue);
+        if (queue.numPatients() != 3 * (int) patients.size() || !testDaryProperty(queue)) {
+            return false;
+        }
+        
+        // A copy converted to a skew heap and back must drain like the original
+        PQueue copiedQueue(queue);
+        copiedQueue.setStructure(SKEW);
+        if (!testMinHeap(copiedQueue)) {
+            return false;
+        }
+        copiedQueue.setStructure(DARY);
+        queue.setPriorityFn(priorityFn1, MAXHEAP);
+        copiedQueue.setPriorityFn(priorityFn1, MAXHEAP);
+        if (!testDaryProperty(queue) || !testDaryProperty(copiedQueue)) {
+            return false;
+        }
+        
+        while (queue.numPatients() > 0) {
+            int priority = priorityFn1(queue.getNextPatient());
+            if (priority != priorityFn1(copiedQueue.getNextPatient())) {
+                return false;
+            }
+            if (queue.numPatients() % 97 == 0 && !testDaryProperty(queue)) {
+                return false;
+            }
+        }
+        
+        // A heap needs at least two children per node
+        try {
+            queue.setArity(1);
+            return false;
+        } catch (const domain_error& e) {}
+        return true;
     }
     
-    PQueue queueFive(priorityFn2, MINHEAP, LEFTIST);
-    PQueue queueSix(queueFive);
-    
-    if (tester.testCopyConstructorEdge(queueThree, queueFour)){
-        cout << "Edge Test Passed: The copy constructor successfully makes a deep copy." << endl;
+    // testGetNextPatients(const vector<Patient>& patients, STRUCTURE structure)
+    // Case: Verify a batch of k patients comes out in the same order as k calls of getNextPatient,
+    // the rest of the queue is still a valid heap, and asking for more patients than queued doesn't throw
+    // Expected result: Return true if both queues give the same priorities and the remainder keeps its heap properties, else return false
+    bool testGetNextPatients(const vector<Patient>& patients, STRUCTURE structure) {
+        PQueue queue = makeQueue(priorityFn1, MAXHEAP, structure, 150, 200);
+        queue.insertPatients(patients.begin(), patients.end());
+        PQueue copiedQueue(queue);
+        
+        const int batches[] = {0, 1, 7, 50};
+        for (int k : batches) {
+            vector<Patient> batch;
+            if (queue.getNextPatients(k, back_inserter(batch)) != k || (int) batch.size() != k) {
+                return false;
+            }
+            for (const Patient& patient : batch) {
+                if (priorityFn1(patient) != priorityFn1(copiedQueue.getNextPatient())) {
+                    return false;
+                }
+            }
+            if (queue.numPatients() != copiedQueue.numPatients() || !testMaxHeap(queue)) {
+                return false;
+            }
+            if (structure == LEFTIST && (!testNPLValues(queue) || !testLeftistProperty(queue))) {
+                return false;
+            }
+            if (structure == DARY && !testDaryProperty(queue)) {
+                return false;
+            }
+        }
+        
+        // The rest of the queue fits in a buffer larger than the queue
+        int remaining = queue.numPatients();
+        vector<Patient> buffer(remaining + 10);
+        if (queue.getNextPatients(remaining + 10, buffer.begin()) != remaining || queue.numPatients() != 0) {
+            return false;
+        }
+        for (int i = 0; i < remaining; i++) {
+            if (priorityFn1(buffer[i]) != priorityFn1(copiedQueue.getNextPatient())) {
+                return false;
+            }
+        }
+        return queue.getNextPatients(5, buffer.begin()) == 0;
+    }
+    
+    // testPeekTopK(const vector<Patient>& patients, STRUCTURE structure)
+    // Case: Verify the priority-ordered iterator and peekTopK visit the patients in the order
+    // getNextPatient removes them, without changing the queue
+    // Expected result: Return true if the orders match and the queue keeps its size and top, else return false
+    bool testPeekTopK(const vector<Patient>& patients, STRUCTURE structure) {
+        PQueue queue = makeQueue(priorityFn2, MINHEAP, structure);
+        queue.insertPatients(patients.begin(), patients.end());
+        Node* top = queue.topNode();
+        
+        vector<Patient> topTwenty = queue.peekTopK(20);
+        vector<Patient> everyone = queue.peekTopK(queue.numPatients() + 10);
+        if (topTwenty.size() != 20 || everyone.size() != patients.size() ||
+            queue.numPatients() != (int) patients.size() || queue.topNode() != top) {
+            return false;
+        }
+        
+        PQueue copiedQueue(queue);
+        int visited = 0;
+        for (PQueue::const_iterator it = queue.begin(); it != queue.end(); ++it, ++visited) {
+            int priority = priorityFn2(copiedQueue.getNextPatient());
+            if (priorityFn2(*it) != priority || priorityFn2(everyone[visited]) != priority ||
+                (visited < 20 && priorityFn2(topTwenty[visited]) != priority)) {
+                return false;
+            }
+        }
+        return visited == queue.numPatients() && PQueue(priorityFn2, MINHEAP, SKEW).peekTopK(3).empty();
+    }
+    
+    // testParentLinks(PQueue& queue)
+    // Case: Verify the parent link of every node points to its parent, or to its previous
+    // sibling in a pairing heap and to the previous patient of its bucket
+    // Expected result: Return true if every parent link is correct, else return false
+    bool testParentLinks(PQueue& queue) {
+        vector<Node*> stack;
+        if (queue.m_heap) {
+            if (queue.m_heap -> m_parent) return false;
+            stack.push_back(queue.m_heap);
+        }
+        while (!stack.empty()) {
+            Node* node = stack.back();
+            stack.pop_back();
+            Node* left = node -> m_left;
+            Node* right = node -> m_right;
+            if ((left && left -> m_parent != node) || (right && right -> m_parent != node)) {
+                return false;
+            }
+            if (left) stack.push_back(left);
+            if (right) stack.push_back(right);
+        }
+        
+        for (size_t bucket = 0; bucket < queue.m_bucketHead.size(); bucket++) {
+            Node* previous = nullptr;
+            for (Node* node = queue.m_bucketHead[bucket]; node; node = node -> m_left) {
+                if (node -> m_parent != previous) return false;
+                previous = node;
+            }
+            if (queue.m_bucketTail[bucket] != previous) return false;
+        }
+        return true;
+    }
+    
+    // testHandles(const vector<Patient>& patients, STRUCTURE structure)
+    // Case: Verify patients are updated and removed through their handles, with new vitals that
+    // raise or lower their priority, before and after the queue is rebuilt
+    // Expected result: Return true if the queue keeps its heap properties and parent links and
+    // drains exactly the expected priorities, and stale handles are rejected, else return false
+    bool testHandles(const vector<Patient>& patients, STRUCTURE structure) {
+        PQueue queue = makeQueue(priorityFn2, MINHEAP, structure);
+        vector<PatientHandle> handles;
+        vector<int> expected;
+        for (const Patient& patient : patients) {
+            handles.push_back(queue.insertPatient(patient));
+        }
+        
+        mt19937 generator(7);
+        uniform_int_distribution<> oxygenGen(MINOX, MAXOX);
+        uniform_int_distribution<> opinionGen(MINOPINION, MAXOPINION);
+        for (int round = 0; round < 2; round++) {
+            for (size_t i = round; i < handles.size(); i += 3) {
+                Patient patient = patients[i];
+                patient.setOxygen(oxygenGen(generator));
+                patient.setOpinion(opinionGen(generator));
+                queue.updatePatient(handles[i], patient);
+            }
+            
+            // The handles stay valid when the nodes are rebuilt in place
+            queue.setPriorityFn(priorityFn2, MINHEAP);
+        }
+        
+        // Remove every fifth patient, a removed patient's handle goes stale
+        for (size_t i = 0; i < handles.size(); i++) {
+            if (i % 5 == 0) {
+                Patient patient = handles[i].m_node -> m_patient;
+                if (!(queue.removePatient(handles[i]) == patient) || queue.contains(handles[i])) {
+                    return false;
+                }
+            } else {
+                expected.push_back(priorityFn2(handles[i].m_node -> m_patient));
+            }
+        }
+        if (queue.numPatients() != (int) expected.size() || !testMinHeap(queue) || !testParentLinks(queue)) {
+            return false;
+        }
+        if (structure == LEFTIST && (!testNPLValues(queue) || !testLeftistProperty(queue))) {
+            return false;
+        }
+        if (structure == DARY && !testDaryProperty(queue)) {
+            return false;
+        }
+        try {
+            queue.removePatient(handles[0]);
+            return false;
+        } catch (const domain_error& e) {}
+        
+        sort(expected.begin(), expected.end());
+        for (int priority : expected) {
+            if (priorityFn2(queue.getNextPatient()) != priority) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // testMergedHandles(const vector<Patient>& patients, STRUCTURE structure, bool lazy)
+    // Case: Keep the handles of a queue that is then merged into another one, eagerly or lazily,
+    // and use them on both queues
+    // Expected result: Return true if the emptied queue rejects the handles and stays empty,
+    // the queue that absorbed the patients accepts them, and it drains in priority order,
+    // else return false
+    bool testMergedHandles(const vector<Patient>& patients, STRUCTURE structure, bool lazy) {
+        PQueue source = makeQueue(priorityFn2, MINHEAP, structure);
+        PQueue target = makeQueue(priorityFn2, MINHEAP, structure);
+        target.setLazyMerge(lazy);
+        vector<PatientHandle> handles;
+        vector<int> expected;
+        for (size_t i = 0; i < patients.size(); i++) {
+            if (i % 2 == 0) {
+                handles.push_back(source.insertPatient(patients[i]));
+            } else {
+                target.insertPatient(patients[i]);
+            }
+            expected.push_back(priorityFn2(patients[i]));
+        }
+        target.mergeWithQueue(source);
+        
+        // The nodes moved with the slabs, so the handles only reach them through the new queue
+        if (source.contains(handles[0]) || !target.contains(handles[0])) {
+            return false;
+        }
+        try {
+            source.removePatient(handles[0]);
+            return false;
+        } catch (const domain_error& e) {}
+        try {
+            source.updatePatient(handles[1], patients[1]);
+            return false;
+        } catch (const domain_error& e) {}
+        try {
+            source.cancelPatient(handles[2]);
+            return false;
+        } catch (const domain_error& e) {}
+        if (source.numPatients() != 0 || source.numDead() != 0) {
+            return false;
+        }
+        
+        // A queue built later reuses the same allocator, its nodes never match foreign handles
+        source.insertPatient(patients[0]);
+        if (source.contains(handles[3]) || source.numPatients() != 1) {
+            return false;
+        }
+        
+        Patient patient = target.removePatient(handles[0]);
+        expected.erase(find(expected.begin(), expected.end(), priorityFn2(patient)));
+        if (target.numPatients() != (int) expected.size() || !testParentLinks(target)) {
+            return false;
+        }
+        sort(expected.begin(), expected.end());
+        for (int priority : expected) {
+            if (priorityFn2(target.getNextPatient()) != priority) {
+                return false;
+            }
+        }
+        return target.numPatients() == 0;
+    }
+    
+    // testLazyMerge(const vector<Patient>& patients, STRUCTURE structure)
+    // Case: Fold many site queues into one with lazy merges, peek and update before the
+    // first dequeue, then drain
+    // Expected result: Return true if the merges are only recorded, the peek and the drain
+    // follow the priority order, and the pending heaps are melded by the first dequeue,
+    // else return false
+    bool testLazyMerge(const vector<Patient>& patients, STRUCTURE structure) {
+        const int numSites = 30;
+        PQueue queue(priorityFn2, MINHEAP, structure);
+        queue.setLazyMerge(true);
+        vector<PatientHandle> handles;
+        vector<int> expected;
+        for (int site = 0; site < numSites; site++) {
+            PQueue siteQueue(priorityFn2, MINHEAP, structure);
+            for (size_t i = site; i < patients.size(); i += numSites) {
+                handles.push_back(siteQueue.insertPatient(patients[i]));
+                expected.push_back(priorityFn2(patients[i]));
+            }
+            queue.mergeWithQueue(siteQueue);
+            if (siteQueue.numPatients() != 0 || siteQueue.m_heap) {
+                return false;
+            }
+        }
+        if (queue.m_pending.size() != numSites || queue.numPatients() != (int) patients.size()) {
+            return false;
+        }
+        
+        // Peeking reads the pending heaps without melding them
+        sort(expected.begin(), expected.end());
+        vector<Patient> top = queue.peekTopK(20);
+        for (size_t i = 0; i < top.size(); i++) {
+            if (priorityFn2(top[i]) != expected[i]) return false;
+        }
+        if (queue.m_pending.size() != numSites) {
+            return false;
+        }
+        
+        // A handle taken before the merge still reaches its patient
+        Patient patient = patients[0];
+        patient.setOxygen(MAXOX);
+        patient.setTemperature(MAXTEMP);
+        expected.erase(find(expected.begin(), expected.end(), priorityFn2(patients[0])));
+        expected.insert(upper_bound(expected.begin(), expected.end(), priorityFn2(patient)), priorityFn2(patient));
+        queue.updatePatient(handles[0], patient);
+        if (!queue.m_pending.empty() || !testMinHeap(queue) || !testParentLinks(queue)) {
+            return false;
+        }
+        
+        // A queue that is itself pending is handed over whole by an eager merge
+        PQueue other(priorityFn2, MINHEAP, structure);
+        other.setLazyMerge(true);
+        for (int i = 0; i < 2; i++) {
+            PQueue siteQueue(priorityFn2, MINHEAP, structure);
+            siteQueue.insertPatient(patients[i]);
+            expected.insert(upper_bound(expected.begin(), expected.end(), priorityFn2(patients[i])), priorityFn2(patients[i]));
+            other.mergeWithQueue(siteQueue);
+        }
+        queue.setLazyMerge(false);
+        queue.mergeWithQueue(other);
+        if (!other.m_pending.empty() || !queue.m_pending.empty()) {
+            return false;
+        }
+        for (size_t i = 0; i < expected.size(); i++) {
+            if (priorityFn2(queue.getNextPatient()) != expected[i]) return false;
+        }
+        return queue.numPatients() == 0;
+    }
+    
+    // testMergeAll(const vector<Patient>& patients, STRUCTURE structure)
+    // Case: Merge 53 regional queues of mixed structures at once on four threads
+    // Expected result: Return true if every patient lands in the merged queue in priority
+    // order, the regional queues are emptied, and bad inputs throw, else return false
+    bool testMergeAll(const vector<Patient>& patients, STRUCTURE structure) {
+        const int numRegions = 53;
+        const STRUCTURE structures[] = {SKEW, LEFTIST, BUCKET, DARY, PAIRING};
+        PQueue queue = makeQueue(priorityFn2, MINHEAP, structure);
+        vector<PQueue> regions;
+        for (int region = 0; region < numRegions; region++) {
+            regions.push_back(makeQueue(priorityFn2, MINHEAP, structures[region % 5], 70 + region % 3, 110));
+        }
+        vector<int> expected;
+        for (size_t i = 0; i < patients.size(); i++) {
+            regions[i % numRegions].insertPatient(patients[i]);
+            expected.push_back(priorityFn2(patients[i]));
+        }
+        vector<PQueue*> pointers;
+        for (PQueue& region : regions) {
+            pointers.push_back(&region);
+        }
+        
+        // A different priority function, a repeated queue or this queue itself are refused
+        PQueue wrongFunction = makeQueue(priorityFn1, MAXHEAP, structure, 150, 200);
+        vector<vector<PQueue*>> badInputs = {pointers, pointers, pointers};
+        badInputs[0].push_back(&wrongFunction);
+        badInputs[1].push_back(pointers[0]);
+        badInputs[2].push_back(&queue);
+        for (const vector<PQueue*>& badInput : badInputs) {
+            try {
+                queue.mergeAll(badInput, 4);
+                return false;
+            } catch (const domain_error& e) {}
+        }
+        if (queue.numPatients() != 0 || regions[0].numPatients() == 0) {
+            return false;
+        }
+        
+        queue.mergeAll(pointers, 4);
+        for (const PQueue& region : regions) {
+            if (region.numPatients() != 0) return false;
+        }
+        if (queue.getStructure() != structure || queue.numPatients() != (int) patients.size() ||
+            !testMinHeap(queue) || !testParentLinks(queue)) {
+            return false;
+        }
+        sort(expected.begin(), expected.end());
+        for (size_t i = 0; i < expected.size(); i++) {
+            if (priorityFn2(queue.getNextPatient()) != expected[i]) return false;
+        }
+        return true;
+    }
+    
+    // testSnapshot(const vector<Patient>& patients, STRUCTURE structure)
+    // Case: Save a queue with tombstones (and pending lazy merges for a tree) to a
+    // snapshot, load it into a queue of another structure, then damage the file
+    // Expected result: Return true if the loaded queue has the same shape, counts and
+    // order as the saved one, and a damaged or missing file throws and leaves the
+    // queue as it was, else return false
+    bool testSnapshot(const vector<Patient>& patients, STRUCTURE structure) {
+        const string path = "mytest.snapshot";
+        PQueue queue = makeQueue(priorityFn2, MINHEAP, structure);
+        queue.setMaxDeadFraction(1.0);
+        queue.setLazyMerge(true);
+        for (int site = 0; site < 3; site++) {
+            PQueue siteQueue = makeQueue(priorityFn2, MINHEAP, structure);
+            vector<PatientHandle> handles;
+            for (size_t i = site; i < patients.size(); i += 3) {
+                handles.push_back(siteQueue.insertPatient(patients[i]));
+            }
+            for (size_t i = 0; i < handles.size(); i += 7) {
+                siteQueue.cancelPatient(handles[i]);
+            }
+            queue.mergeWithQueue(siteQueue);
+        }
+        queue.saveSnapshot(path);
+        
+        PQueue loaded(priorityFn2, MINHEAP, structure == SKEW ? LEFTIST : SKEW);
+        loaded.insertPatient(patients[0]);
+        loaded.loadSnapshot(path);
+        if (loaded.getStructure() != structure || loaded.numPatients() != queue.numPatients() ||
+            loaded.numDead() != queue.numDead() ||
+            loaded.m_pending.size() + (loaded.m_heap != nullptr) != queue.m_pending.size() + (queue.m_heap != nullptr) ||
+            !testMinHeap(loaded) || !testParentLinks(loaded)) {
+            return false;
+        }
+        if (structure == LEFTIST && (!testNPLValues(loaded) || !testLeftistProperty(loaded))) {
+            return false;
+        }
+        if (structure == DARY && !testDaryProperty(loaded)) {
+            return false;
+        }
+        
+        // Damage one byte of a record, flip the heap type (header byte 20) or the arity
+        // (header byte 28), cut the file short, or remove it; the queue is kept
+        ifstream source(path, ios::binary);
+        string bytes((istreambuf_iterator<char>(source)), istreambuf_iterator<char>());
+        source.close();
+        int size = loaded.numPatients();
+        for (int damage = 0; damage < 5; damage++) {
+            string broken = bytes;
+            if (damage == 0) {
+                broken[broken.size() - 30] ^= 0x10;
+            } else if (damage == 1) {
+                broken[20] ^= 0x01;
+            } else if (damage == 2) {
+                broken[28] ^= 0x01;
+            } else if (damage == 3) {
+                broken.resize(broken.size() - 1);
+            }
+            remove(path.c_str());
+            if (damage < 4) {
+                ofstream target(path, ios::binary);
+                target.write(broken.data(), broken.size());
+            }
+            try {
+                loaded.loadSnapshot(path);
+                return false;
+            } catch (const runtime_error& e) {}
+            if (loaded.numPatients() != size) {
+                return false;
+            }
+        }
+        
+        // Both queues hand out the same patients in the same order, FIFO ties included
+        while (queue.numPatients() > 0) {
+            if (!(queue.getNextPatient() == loaded.getNextPatient())) return false;
+        }
+        return loaded.numPatients() == 0;
+    }
+    
+    // testPatientFeed(const vector<Patient>& patients)
+    // Case: Read a CSV feed with bad rows through tiny chunks and batches, then the
+    // waiting room as a CSV feed and as a binary feed with a bad and a short record
+    // Expected result: Return true if every valid row is queued, every bad row is reported
+    // with its line or record number, and no EMPTY patient is queued, else return false
+    bool testPatientFeed(const vector<Patient>& patients) {
+        const string csvPath = "mytest_feed.csv";
+        const string binaryPath = "mytest_feed.bin";
+        {
+            ofstream file(csvPath, ios::binary);
+            file << "name,temperature,oxygen,RR,BP,opinion\n"
+                 << "Sam,37,95,20,120,3\r\n"
+                 << "\n"
+                 << "Alex,50,95,20,120,3\n"
+                 << "Jo,37,9x,20,120,3\n"
+                 << "Kim,37,95,20\n"
+                 << ",37,95,20,120,3\n"
+                 << "Avery Jonathan Longname,36,99,15,100,1\n"
+                 << "Lee,37,95,20,120,3,7\n"
+                 << "Max,42,101,40,160,10";
+        }
+        PQueue queue(priorityFn2, MINHEAP, SKEW);
+        PatientFeed feed(csvPath, CSVFEED, 16, 2);
+        const vector<long long> rejectedRows = {4, 5, 6, 7, 9};
+        const vector<string> reasons = {"temperature 50 out of range 35-42", "oxygen is not a number",
+                                        "expected 6 fields", "empty name", "expected 6 fields"};
+        if (feed.readInto(queue) != 3 || queue.numPatients() != 3 || feed.numRows() != 8 ||
+            feed.getRejections().size() != rejectedRows.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < rejectedRows.size(); i++) {
+            if (feed.getRejections()[i].m_row != rejectedRows[i] || feed.getRejections()[i].m_reason != reasons[i]) {
+                return false;
+            }
+        }
+        vector<string> names;
+        while (queue.numPatients() > 0) {
+            names.push_back(queue.getNextPatient().getPatient());
+        }
+        sort(names.begin(), names.end());
+        if (names != vector<string>{"Avery Jonathan Lon", "Max", "Sam"}) {
+            return false;
+        }
+        
+        // The waiting room comes out of both feeds in the order of a queue filled by hand
+        {
+            ofstream file(csvPath, ios::binary);
+            for (const Patient& patient : patients) {
+                file << patient.getPatient() << "," << patient.getTemperature() << "," << patient.getOxygen() << ","
+                     << patient.getRR() << "," << patient.getBP() << "," << patient.getOpinion() << "\n";
+            }
+        }
+        PatientFeed::writeBinary(binaryPath, patients);
+        {
+            ofstream file(binaryPath, ios::binary | ios::app);
+            char record[FEEDRECORDSIZE] = "Pat";
+            record[MAXNAME + 1] = 37;
+            record[MAXNAME + 2] = 95;
+            record[MAXNAME + 3] = 20;
+            record[MAXNAME + 4] = 120;
+            record[MAXNAME + 5] = 11;
+            file.write(record, FEEDRECORDSIZE);
+            file.write(record, 5);
+        }
+        PQueue expected(priorityFn2, MINHEAP, SKEW);
+        for (const Patient& patient : patients) {
+            expected.insertPatient(patient);
+        }
+        PQueue csvQueue(priorityFn2, MINHEAP, SKEW);
+        PQueue binaryQueue(priorityFn2, MINHEAP, SKEW);
+        PatientFeed csvFeed(csvPath, CSVFEED, 100, 7);
+        PatientFeed binaryFeed(binaryPath, BINARYFEED, 50, 7);
+        if (csvFeed.readInto(csvQueue) != (int) patients.size() || !csvFeed.getRejections().empty() ||
+            binaryFeed.readInto(binaryQueue) != (int) patients.size() || binaryFeed.getRejections().size() != 2 ||
+            binaryFeed.getRejections()[0].m_row != (long long) patients.size() + 1 ||
+            binaryFeed.getRejections()[0].m_reason != "nurse opinion 11 out of range 1-10" ||
+            binaryFeed.getRejections()[1].m_reason != "truncated record") {
+            return false;
+        }
+        while (expected.numPatients() > 0) {
+            int key = priorityFn2(expected.getNextPatient());
+            if (priorityFn2(csvQueue.getNextPatient()) != key || priorityFn2(binaryQueue.getNextPatient()) != key) {
+                return false;
+            }
+        }
+        remove(csvPath.c_str());
+        remove(binaryPath.c_str());
+        
+        try {
+            PatientFeed missing(csvPath, CSVFEED);
+            missing.readInto(queue);
+            return false;
+        } catch (const runtime_error& e) {}
+        return true;
+    }
+    
+    // testStats(const vector<Patient>& patients, STRUCTURE structure)
+    // Case: Fill a queue, dequeue some patients and ask for its statistics
+    // Expected result: Return true if every node of the trees is counted once in the NPL
+    // distribution, a leftist heap agrees with its stored NPLs and right spine, and the
+    // counters count only when built with PQUEUE_STATS, else return false
+    bool testStats(const vector<Patient>& patients, STRUCTURE structure) {
+        PQueue queue = makeQueue(priorityFn2, MINHEAP, structure);
+        for (const Patient& patient : patients) {
+            queue.insertPatient(patient);
+        }
+        for (int i = 0; i < 5; i++) {
+            queue.getNextPatient();
+        }
+        PQueueStats stats = queue.stats();
+        int counted = 0;
+        for (int count : stats.m_nplCounts) {
+            counted += count;
+        }
+        if (stats.m_size != queue.numPatients() || stats.m_numDead != queue.numDead()) {
+            return false;
+        }
+        if ((structure == SKEW || structure == LEFTIST) && counted != queue.numPatients()) {
+            return false;
+        }
+        if (structure == LEFTIST) {
+            // The distribution and the right spine match the NPLs kept in the nodes
+            vector<int> stored;
+            vector<Node*> stack(1, queue.m_heap);
+            while (!stack.empty()) {
+                Node* node = stack.back();
+                stack.pop_back();
+                if ((int) stored.size() <= node -> m_npl) stored.resize(node -> m_npl + 1, 0);
+                stored[node -> m_npl]++;
+                if (node -> m_left) stack.push_back(node -> m_left);
+                if (node -> m_right) stack.push_back(node -> m_right);
+            }
+            if (stored != stats.m_nplCounts || stats.m_rightSpine != queue.m_heap -> m_npl + 1) {
+                return false;
+            }
+        }
+        if (stats.m_maxDepth < 1 || stats.toText().find("size=") != 0 || stats.toJSON().front() != '{') {
+            return false;
+        }
+        
+        // A removed layer of counters is all zero, a built one saw every patient inserted
+#ifdef PQUEUE_STATS
+        if (stats.m_counters.m_allocations != (long long) patients.size() ||
+            stats.m_counters.m_priorityCalls < (long long) patients.size() ||
+            stats.m_counters.m_comparisons == 0) {
+            return false;
+        }
+        queue.resetCounters();
+        return queue.stats().m_counters.m_comparisons == 0;
+#else
+        return stats.m_counters.m_comparisons + stats.m_counters.m_priorityCalls +
+               stats.m_counters.m_allocations + stats.m_counters.m_rebuilds == 0;
+#endif
+    }
+    
+    // testCancelPatient(const vector<Patient>& patients, STRUCTURE structure)
+    // Case: Verify cancelled patients are skipped by every way of reading the queue, and the
+    // queue compacts itself once the tombstones pass the configured fraction
+    // Expected result: Return true if the live and dead counts are right, no cancelled patient
+    // comes out, and the tombstones never exceed the fraction, else return false
+    bool testCancelPatient(const vector<Patient>& patients, STRUCTURE structure) {
+        PQueue queue = makeQueue(priorityFn2, MINHEAP, structure);
+        queue.setMaxDeadFraction(1.0);
+        vector<PatientHandle> handles;
+        for (const Patient& patient : patients) {
+            handles.push_back(queue.insertPatient(patient));
+        }
+        
+        // Cancel every third patient, no compaction happens below one tombstone per live patient
+        vector<int> expected;
+        int cancelled = 0;
+        for (size_t i = 0; i < handles.size(); i++) {
+            if (i % 3 == 0) {
+                queue.cancelPatient(handles[i]);
+                cancelled++;
+                if (queue.contains(handles[i])) return false;
+            } else {
+                expected.push_back(priorityFn2(patients[i]));
+            }
+        }
+        sort(expected.begin(), expected.end());
+        if (queue.numDead() != cancelled || queue.numPatients() != (int) expected.size()) {
+            return false;
+        }
+        try {
+            queue.cancelPatient(handles[0]);
+            return false;
+        } catch (const domain_error& e) {}
+        
+        // The iterator and a copy both skip the tombstones
+        vector<Patient> everyone = queue.peekTopK(queue.numPatients() + 10);
+        PQueue copiedQueue(queue);
+        if (everyone.size() != expected.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < expected.size(); i++) {
+            if (priorityFn2(everyone[i]) != expected[i] || priorityFn2(copiedQueue.getNextPatient()) != expected[i]) {
+                return false;
+            }
+        }
+        
+        // A batch, then single patients, never return a cancelled patient
+        vector<Patient> batch;
+        queue.getNextPatients(10, back_inserter(batch));
+        for (int i = 0; i < 10; i++) {
+            if (priorityFn2(batch[i]) != expected[i]) return false;
+        }
+        for (size_t i = 10; i < expected.size() / 2; i++) {
+            if (priorityFn2(queue.getNextPatient()) != expected[i]) return false;
+        }
+        
+        // A lower fraction compacts at once, and keeps the tombstones under it from then on
+        queue.setMaxDeadFraction(0.1);
+        if (queue.numDead() > 0.1 * queue.numPatients() || !testMinHeap(queue) || !testParentLinks(queue)) {
+            return false;
+        }
+        for (size_t i = 1; i < handles.size(); i += 3) {
+            if (queue.contains(handles[i])) {
+                queue.cancelPatient(handles[i]);
+                if (queue.numDead() > 0.1 * queue.numPatients()) return false;
+            }
+        }
+        if (structure == LEFTIST && (!testNPLValues(queue) || !testLeftistProperty(queue))) {
+            return false;
+        }
+        if (structure == DARY && !testDaryProperty(queue)) {
+            return false;
+        }
+        queue.compact();
+        return queue.numDead() == 0 && queue.numPatients() == (int) queue.peekTopK(1000).size();
+    }
+    
+    // testConcurrentPQueue(const vector<Patient>& patients)
+    // Case: Verify two desk threads insert into the concurrent queue without losing patients,
+    // and the queue reports it is empty once every patient has been dequeued
+    // Expected result: Return true if every patient comes out once, each sub-queue keeps the heap property and tryGetNextPatient fails on an empty queue, else return false
+    bool testConcurrentPQueue(const vector<Patient>& patients) {
+        ConcurrentPQueue queue(priorityFn2, MINHEAP, LEFTIST, 4);
+        thread deskOne([&]() {
+            for (size_t i = 0; i < patients.size(); i += 2) queue.insertPatient(patients[i]);
+        });
+        thread deskTwo([&]() {
+            for (size_t i = 1; i < patients.size(); i += 2) queue.insertPatient(patients[i]);
+        });
+        deskOne.join();
+        deskTwo.join();
+        
+        if (queue.numPatients() != (int) patients.size()) {
+            return false;
+        }
+        for (const auto& sub : queue.m_queues) {
+            if (!testMinHeap(sub -> m_queue) || !testLeftistProperty(sub -> m_queue)) {
+                return false;
+            }
+        }
+        
+        // Every priority inserted comes out exactly once
+        vector<int> expected, actual;
+        for (const Patient& patient : patients) {
+            expected.push_back(priorityFn2(patient));
+        }
+        Patient patient;
+        while (queue.tryGetNextPatient(patient)) {
+            actual.push_back(priorityFn2(patient));
+        }
+        sort(expected.begin(), expected.end());
+        sort(actual.begin(), actual.end());
+        if (actual != expected || queue.numPatients() != 0 || queue.tryGetNextPatient(patient)) {
+            return false;
+        }
+
+        // Bucket sub-queues take their key range from the constructor, the keys outside
+        // it overflow in each sub-queue
+        ConcurrentPQueue bucketQueue(priorityFn2, MINHEAP, 80, 100, 4);
+        thread deskThree([&]() {
+            for (size_t i = 0; i < patients.size(); i += 2) bucketQueue.insertPatient(patients[i]);
+        });
+        thread deskFour([&]() {
+            for (size_t i = 1; i < patients.size(); i += 2) bucketQueue.insertPatient(patients[i]);
+        });
+        deskThree.join();
+        deskFour.join();
+        actual.clear();
+        while (bucketQueue.tryGetNextPatient(patient)) {
+            actual.push_back(priorityFn2(patient));
+        }
+        sort(actual.begin(), actual.end());
+        if (actual != expected || bucketQueue.m_queues[0] -> m_queue.getStructure() != BUCKET) {
+            return false;
+        }
+        try {
+            ConcurrentPQueue noRange(priorityFn2, MINHEAP, BUCKET, 4);
+            return false;
+        } catch (const domain_error& e) {}
+        return true;
+    }
+    
+    // testLatencyHistogram(const vector<Patient>& patients)
+    // Case: Record known latencies from two threads, then attach a recorder to a queue
+    // and to a concurrent queue and run every recorded operation
+    // Expected result: Return true if every latency lands in a bucket that holds it, the
+    // percentiles are within a bucket of the exact ones, reset clears the counts, and the
+    // recorders count one latency per operation, else return false
+    bool testLatencyHistogram(const vector<Patient>& patients) {
+        for (long long value : {0LL, 1LL, 31LL, 32LL, 33LL, 1000LL, 123456789LL, 1LL << 47}) {
+            int bucket = LatencyHistogram::bucketOf(value);
+            if (LatencyHistogram::bucketLow(bucket) > value || LatencyHistogram::bucketHigh(bucket) < value ||
+                bucket < 0 || bucket >= LATENCYBUCKETS) {
+                return false;
+            }
+        }
+        
+        // Two threads record 1..100000 ns between them
+        LatencyHistogram histogram;
+        thread odd([&]() { for (long long ns = 1; ns <= 100000; ns += 2) histogram.record(ns); });
+        thread even([&]() { for (long long ns = 2; ns <= 100000; ns += 2) histogram.record(ns); });
+        odd.join();
+        even.join();
+        LatencySnapshot snapshot = histogram.snapshot();
+        if (snapshot.m_count != 100000 || snapshot.m_max != 100000 || snapshot.mean() != 50000.5) {
+            return false;
+        }
+        for (double p : {0.5, 0.9, 0.99, 0.999}) {
+            long long exact = (long long) (p * 100000);
+            long long reported = snapshot.percentile(p);
+            if (reported < exact || reported > exact + exact / LATENCYSUBBUCKETS) {
+                return false;
+            }
+        }
+        histogram.reset();
+        if (histogram.count() != 0 || histogram.percentile(0.99) != 0) {
+            return false;
+        }
+        
+        // One latency per insert, dequeue and merge, and one per rebuild
+        LatencyRecorder recorder;
+        PQueue queue(priorityFn2, MINHEAP, SKEW);
+        PQueue desk(priorityFn2, MINHEAP, SKEW);
+        queue.setLatencyRecorder(&recorder);
+        for (const Patient& patient : patients) {
+            queue.insertPatient(patient);
+            desk.insertPatient(patient);
+        }
+        queue.mergeWithQueue(desk);
+        queue.setPriorityFn(priorityFn1, MAXHEAP);
+        PQueue copy(queue);
+        while (copy.numPatients() > 0) {
+            copy.getNextPatient();
+        }
+        if (copy.getLatencyRecorder() != &recorder || recorder.histogram(INSERTLATENCY).count() != (long long) patients.size() ||
+            recorder.histogram(MERGELATENCY).count() != 1 || recorder.histogram(REBUILDLATENCY).count() != 1 ||
+            recorder.histogram(DEQUEUELATENCY).count() != 2 * (long long) patients.size() ||
+            recorder.report().find("p99.9=") == string::npos) {
+            return false;
+        }
+        
+        // The sub-queues of a concurrent queue share one recorder
+        recorder.reset();
+        ConcurrentPQueue concurrent(priorityFn2, MINHEAP, LEFTIST, 4);
+        concurrent.setLatencyRecorder(&recorder);
+        thread deskOne([&]() {
+            for (size_t i = 0; i < patients.size(); i += 2) concurrent.insertPatient(patients[i]);
+        });
+        thread deskTwo([&]() {
+            for (size_t i = 1; i < patients.size(); i += 2) concurrent.insertPatient(patients[i]);
+        });
+        deskOne.join();
+        deskTwo.join();
+        return recorder.histogram(INSERTLATENCY).count() == (long long) patients.size() &&
+               recorder.histogram(DEQUEUELATENCY).count() == 0;
+    }
+    
+    // persistentNodes(const PersistentPQueue& queue, set<const void*>& nodes)
+    // Collect the nodes of a version and check the leftist property of each of them
+    // Return false if a node has the wrong null path length or its children swapped
+    bool persistentNodes(const PersistentPQueue& queue, set<const void*>& nodes) {
+        vector<const PersistentPQueue::PNode*> stack;
+        if (queue.m_heap) stack.push_back(queue.m_heap.get());
+        while (!stack.empty()) {
+            const PersistentPQueue::PNode* node = stack.back();
+            stack.pop_back();
+            nodes.insert(node);
+            int left = PersistentPQueue::getNPL(node -> m_left);
+            int right = PersistentPQueue::getNPL(node -> m_right);
+            if (left < right || node -> m_npl != right + 1) {
+                return false;
+            }
+            if (node -> m_left) stack.push_back(node -> m_left.get());
+            if (node -> m_right) stack.push_back(node -> m_right.get());
+        }
+        return true;
+    }
+    
+    // testPersistentPQueue(const vector<Patient>& patients)
+    // Case: Copy a persistent queue, change the copy, and drain two copies of one version
+    // in two threads
+    // Expected result: Return true if a copy shares the root, an insert or dequeue adds only
+    // O(log n) nodes, the older versions keep their patients, and every version drains in
+    // the same order as a leftist PQueue, else return false
+    bool testPersistentPQueue(const vector<Patient>& patients) {
+        PersistentPQueue queue(priorityFn2, MINHEAP);
+        PQueue expected(priorityFn2, MINHEAP, LEFTIST);
+        for (const Patient& patient : patients) {
+            queue.insertPatient(patient);
+            expected.insertPatient(patient);
+        }
+        PersistentPQueue copy(queue);
+        PersistentPQueue snapshot = queue.snapshot();
+        if (copy.m_heap != queue.m_heap || snapshot.m_heap != queue.m_heap || copy.numPatients() != (int) patients.size()) {
+            return false;
+        }
+        
+        // A new version holds only a right spine's worth of new nodes
+        set<const void*> original, changed;
+        int bound = 2 * (int) log2(patients.size() + 1) + 2;
+        copy.insertPatient(patients[0]);
+        copy.getNextPatient();
+        copy.getNextPatient();
+        if (!persistentNodes(queue, original) || !persistentNodes(copy, changed)) {
+            return false;
+        }
+        int created = 0;
+        for (const void* node : changed) {
+            created += original.count(node) == 0;
+        }
+        if (created > 3 * bound || copy.numPatients() != (int) patients.size() - 1 ||
+            queue.numPatients() != (int) patients.size()) {
+            return false;
+        }
+        
+        // Different priority functions are rejected and leave the queue as it was
+        try {
+            copy.mergeWithQueue(PersistentPQueue(priorityFn1, MAXHEAP));
+            return false;
+        } catch (const domain_error& e) {}
+        PersistentPQueue doubled(snapshot);
+        doubled.mergeWithQueue(snapshot);
+        if (doubled.numPatients() != 2 * (int) patients.size() || snapshot.numPatients() != (int) patients.size()) {
+            return false;
+        }
+        
+        // Two threads drain their own copies of the same version at the same time
+        vector<int> first, second;
+        PersistentPQueue firstCopy(snapshot), secondCopy(snapshot);
+        thread drainOne([&]() { while (firstCopy.numPatients() > 0) first.push_back(priorityFn2(firstCopy.getNextPatient())); });
+        thread drainTwo([&]() { while (secondCopy.numPatients() > 0) second.push_back(priorityFn2(secondCopy.getNextPatient())); });
+        drainOne.join();
+        drainTwo.join();
+        for (size_t i = 0; i < first.size(); i++) {
+            if (first[i] != priorityFn2(expected.getNextPatient())) return false;
+        }
+        return first == second && first.size() == patients.size() && queue.numPatients() == (int) patients.size() &&
+               priorityFn2(queue.getTop()) == first[0];
+    }
+    
+    // drainsFirstComeFirstServed(Queue& queue, prifn_t priFn)
+    // Helper function of testFifoTies that drains a queue of patients named by their
+    // arrival and checks equal priorities leave in arrival order
+    template <class Queue>
+    bool drainsFirstComeFirstServed(Queue& queue, prifn_t priFn) {
+        vector<int> lastArrival(1000, -1);
+        while (queue.numPatients() > 0) {
+            Patient patient = queue.getNextPatient();
+            int arrival = stoi(patient.getPatient());
+            int& last = lastArrival[priFn(patient)];
+            if (arrival < last) {
+                return false;
+            }
+            last = arrival;
+        }
+        return true;
+    }
+    
+    // testFifoTies(const vector<Patient>& patients, STRUCTURE structure)
+    // Case: Queue patients with few distinct priorities one at a time, in bulk and through
+    // a merge, update some of them, convert the structure, switch the heap type, and let
+    // the arrival numbers wrap around. A bucket queue keeps most keys of both priority
+    // functions in its buckets. With LEFTIST the persistent queue, a leftist heap too, is
+    // checked with its versions, merges and wrapping arrival numbers
+    // Expected result: Return true if patients of equal priority always leave in the order
+    // they arrived, for a min-heap and a max-heap, else return false
+    bool testFifoTies(const vector<Patient>& patients, STRUCTURE structure) {
+        vector<Patient> named(patients);
+        for (size_t i = 0; i < named.size(); i++) {
+            named[i].setPatient(to_string(i));
+        }
+        size_t half = named.size() / 2;
+        for (HEAPTYPE heapType : {MINHEAP, MAXHEAP}) {
+            PQueue queue = makeQueue(priorityFn2, heapType, structure, 80, 200);
+            vector<PatientHandle> handles;
+            for (size_t i = 0; i < half; i++) {
+                handles.push_back(queue.insertPatient(named[i]));
+            }
+            queue.insertPatients(named.begin() + half, named.end());
+            PQueue copy(queue);
+            if (!drainsFirstComeFirstServed(copy, priorityFn2)) {
+                return false;
+            }
+            
+            // An update keeps the place in line, with the same vitals or with new ones
+            for (size_t i = 0; i < handles.size(); i += 3) {
+                Patient patient = named[i];
+                if (i % 2 == 1) {
+                    patient.setOpinion(patient.getOpinion() % MAXOPINION + 1);
+                }
+                queue.updatePatient(handles[i], patient);
+            }
+            copy = queue;
+            if (!drainsFirstComeFirstServed(copy, priorityFn2)) {
+                return false;
+            }
+            
+            // A round trip through another structure rebuilds it in arrival order
+            copy = queue;
+            copy.setStructure(structure == SKEW ? LEFTIST : SKEW);
+            copy.setStructure(structure);
+            if (!drainsFirstComeFirstServed(copy, priorityFn2)) {
+                return false;
+            }
+            
+            // The other heap type keeps the arrival numbers
+            queue.setPriorityFn(priorityFn1, heapType == MINHEAP ? MAXHEAP : MINHEAP);
+            if (!drainsFirstComeFirstServed(queue, priorityFn1)) {
+                return false;
+            }
+            
+            // A desk that numbers its arrivals after the main queue's keeps them in order
+            PQueue first = makeQueue(priorityFn2, heapType, structure);
+            PQueue second(first);
+            second.m_arrivals = (unsigned int) half;
+            for (size_t i = 0; i < named.size(); i++) {
+                (i < half ? first : second).insertPatient(named[i]);
+            }
+            first.mergeWithQueue(second);
+            if (first.m_arrivals != named.size()) {
+                return false;
+            }
+            if (!drainsFirstComeFirstServed(first, priorityFn2)) {
+                return false;
+            }
+            
+            // Arrival numbers that are about to wrap are numbered again from 0
+            PQueue wrapped = makeQueue(priorityFn2, heapType, structure);
+            wrapped.m_arrivals = 0xFFFFFFFFu - (unsigned int) half;
+            for (size_t i = 0; i < named.size(); i++) {
+                wrapped.insertPatient(named[i]);
+            }
+            if (wrapped.m_arrivals != named.size() || wrapped.numPatients() != (int) named.size() ||
+                !drainsFirstComeFirstServed(wrapped, priorityFn2)) {
+                return false;
+            }
+            
+            if (structure == LEFTIST && !testPersistentFifoTies(named, heapType)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // testPersistentFifoTies(const vector<Patient>& named, HEAPTYPE heapType)
+    // Helper function of testFifoTies for the persistent queue, the patients are named by
+    // their arrival
+    bool testPersistentFifoTies(const vector<Patient>& named, HEAPTYPE heapType) {
+        size_t half = named.size() / 2;
+        PersistentPQueue queue(priorityFn2, heapType);
+        for (size_t i = 0; i < half; i++) {
+            queue.insertPatient(named[i]);
+        }
+        
+        // A snapshot and the version that goes on share the first half and number on alike
+        PersistentPQueue snapshot = queue.snapshot();
+        for (size_t i = half; i < named.size(); i++) {
+            queue.insertPatient(named[i]);
+        }
+        PersistentPQueue copy(queue);
+        if (!drainsFirstComeFirstServed(copy, priorityFn2) || !drainsFirstComeFirstServed(snapshot, priorityFn2)) {
+            return false;
+        }
+        
+        // A version that numbers its arrivals after the other one's keeps them in order
+        PersistentPQueue first(priorityFn2, heapType), second(priorityFn2, heapType);
+        second.m_arrivals = (unsigned int) half;
+        for (size_t i = 0; i < named.size(); i++) {
+            (i < half ? first : second).insertPatient(named[i]);
+        }
+        first.mergeWithQueue(second);
+        if (first.m_arrivals != named.size() || !drainsFirstComeFirstServed(first, priorityFn2)) {
+            return false;
+        }
+        
+        // Arrival numbers that are about to wrap are numbered again from 0, the version taken
+        // before keeps its own numbers
+        PersistentPQueue wrapped(priorityFn2, heapType);
+        wrapped.m_arrivals = 0xFFFFFFFFu - (unsigned int) half;
+        for (size_t i = 0; i < half; i++) {
+            wrapped.insertPatient(named[i]);
+        }
+        PersistentPQueue beforeWrap = wrapped.snapshot();
+        for (size_t i = half; i < named.size(); i++) {
+            wrapped.insertPatient(named[i]);
+        }
+        return wrapped.m_arrivals == named.size() && wrapped.numPatients() == (int) named.size() &&
+               drainsFirstComeFirstServed(wrapped, priorityFn2) && drainsFirstComeFirstServed(beforeWrap, priorityFn2);
+    }
+    
+    // testBucketQueue(const vector<Patient>& patients)
+    // Case: Verify a bucket queue whose key range covers only part of the priorities, with the
+    // other keys in the overflow heap, is copied, merged and converted without losing order
+    // Expected result: Return true if every queue drains in priority order with its size intact, else return false
+    bool testBucketQueue(const vector<Patient>& patients) {
+        PQueue queue(priorityFn2, MINHEAP, 80, 100);
+        queue.insertPatients(patients.begin(), patients.end());
+        if (queue.getStructure() != BUCKET || queue.numPatients() != (int) patients.size()) {
+            return false;
+        }
+        
+        // A second range merges bucket by bucket, a different range patient by patient
+        PQueue sameRange(priorityFn2, MINHEAP, 80, 100);
+        PQueue otherRange(priorityFn2, MINHEAP, 71, 111);
+        sameRange.insertPatients(patients.begin(), patients.end());
+        otherRange.insertPatients(patients.begin(), patients.end());
+        queue.mergeWithQueue(sameRange);
+        queue.mergeWithQueue(otherRange);
+        if (queue.numPatients() != 3 * (int) patients.size() || sameRange.numPatients() != 0) {
+            return false;
+        }
+        
+        // A copy converted to a leftist heap and back must drain like the original
+        PQueue copiedQueue(queue);
+        copiedQueue.setStructure(LEFTIST);
+        if (!testMinHeap(copiedQueue) || !testNPLValues(copiedQueue)) {
+            return false;
+        }
+        copiedQueue.setStructure(BUCKET);
+        
+        while (queue.numPatients() > 0) {
+            int priority = priorityFn2(queue.getNextPatient());
+            if (priority != priorityFn2(copiedQueue.getNextPatient())) {
+                return false;
+            }
+        }
+        
+        // Patients of the same key leave their bucket in arrival order
+        PQueue fifoQueue(priorityFn1, MAXHEAP, 115, 242);
+        fifoQueue.emplacePatient("Nolan Russell", 37, 90, 20, 100, 5);
+        fifoQueue.emplacePatient("Ivy Schmidt", 37, 90, 20, 100, 5);
+        fifoQueue.emplacePatient("Cade Hendrix", 38, 90, 20, 100, 5);
+        if (fifoQueue.getNextPatient().getPatient() != "Cade Hendrix" ||
+            fifoQueue.getNextPatient().getPatient() != "Nolan Russell" ||
+            fifoQueue.getNextPatient().getPatient() != "Ivy Schmidt") {
+            return false;
+        }
+        
+        // A bucket queue needs a key range that fits in MAXBUCKETS buckets
+        try {
+            PQueue skewQueue(priorityFn2, MINHEAP, SKEW);
+            skewQueue.setStructure(BUCKET);
+            return false;
+        } catch (const domain_error& e) {}
+        try {
+            PQueue wideQueue(priorityFn2, MINHEAP, 0, MAXBUCKETS);
+            return false;
+        } catch (const domain_error& e) {}
+        return true;
+    }
+};
+
+int main(){
+    Tester tester;
+    
+    Random nameGen(0,NUMNAMES-1);
+    Random temperatureGen(MINTEMP,MAXTEMP);
+    Random oxygenGen(MINOX,MAXOX);
+    Random respiratoryGen(MINRR,MAXRR);
+    Random bloodPressureGen(MINBP,MAXBP);
+    Random nurseOpinionGen(MINOPINION,MAXOPINION);
+    
+    PQueue minHeapQueue(priorityFn2, MINHEAP, LEFTIST);
+    PQueue maxHeapQueue(priorityFn1, MAXHEAP, LEFTIST);
+    for (int i = 0; i < 300; i++){
+        Patient patient(nameDB[nameGen.getRandNum()],
+                    temperatureGen.getRandNum(),
+                    oxygenGen.getRandNum(),
+                    respiratoryGen.getRandNum(),
+                    bloodPressureGen.getRandNum(),
+                    nurseOpinionGen.getRandNum());
+        minHeapQueue.insertPatient(patient);
+        maxHeapQueue.insertPatient(patient);
+    }
+    
+    //minHeapQueue.dump();
+    if (tester.testMinHeap(minHeapQueue)){
+        cout << "Min-Heap test is passed!" << endl;
+    } else {
+        cout << "Min-Heap test is failed!" << endl;
+    }
+    
+    //maxHeapQueue.dump();
+    if (tester.testMaxHeap(maxHeapQueue)){
+        cout << "Max-Heap test is passed!" << endl;
+    } else {
+        cout << "Max-Heap test is failed!" << endl;
+    }
+    
+    PQueue minHeapQueueRemove(priorityFn2, MINHEAP, LEFTIST);
+    PQueue maxHeapQueueRemove(priorityFn1, MAXHEAP, LEFTIST);
+    for (int i = 0; i < 300; i++){
+        Patient patient(nameDB[nameGen.getRandNum()],
+                    temperatureGen.getRandNum(),
+                    oxygenGen.getRandNum(),
+                    respiratoryGen.getRandNum(),
+                    bloodPressureGen.getRandNum(),
+                    nurseOpinionGen.getRandNum());
+        minHeapQueueRemove.insertPatient(patient);
+        maxHeapQueueRemove.insertPatient(patient);
+    }
+    
+    if (tester.testMinHeapRemoval(minHeapQueueRemove)) {
+        cout << "Test passed: Min-Heap removal is correct." << endl;
+    } else {
+        cout << "Test failed: Removal order is incorrect." << endl;
+    };
+    
+    if (tester.testMaxHeapRemoval(maxHeapQueueRemove)){
+        cout << "Test passed: Max-Heap removal is correct." << endl;
+    } else {
+        cout << "Test failed: Removal order is incorrect." << endl;
+    }
+    
+    PQueue leftistHeapOne(priorityFn2, MINHEAP, LEFTIST);
+    PQueue leftistHeapTwo(priorityFn2, MINHEAP, LEFTIST);
+    PQueue TreeOne(priorityFn2, MINHEAP, LEFTIST);
+
+    for (int i = 0; i < 5; i++){
+        Patient patient(nameDB[nameGen.getRandNum()],
+                    temperatureGen.getRandNum(),
+                    oxygenGen.getRandNum(),
+                    respiratoryGen.getRandNum(),
+                    bloodPressureGen.getRandNum(),
+                    nurseOpinionGen.getRandNum());
+        leftistHeapOne.insertPatient(patient);
+        leftistHeapTwo.insertPatient(patient);
+        TreeOne.insertPatient(patient);
+    }
+     
+    //TreeOne.dump();
+    
+    if (tester.testNPLValues(leftistHeapOne)) {
+        cout << "Test passed: All nodes in a leftist heap have the correct NPL values." << endl;
+    } else {
+        cout << "Test failed: Not every nodes in a leftist heap have the correct NPL values." << endl;
+    }
+    
+    if (tester.testNPLValues(leftistHeapTwo)) {
+        cout << "Test passed: Leftist heap property is maintained!" << endl;
+    } else {
+        cout << "Test failed: Not every node the NPL value of the left child is greater than or equal to the NPL value of the right child!" << endl;
+    }
+
+    TreeOne.setPriorityFn(priorityFn1, MAXHEAP);
+    if (tester.testCachedKeys(TreeOne)) {
+        cout << "Test passed: Cached keys are refreshed with the new priority function." << endl;
+    } else {
+        cout << "Test failed: Cached keys do not match the new priority function." << endl;
+    }
+    
+    if (tester.testPriorityFunction(TreeOne)) {
+        cout << "Test Passed: Heap rebuilt correctly with new priority function." << endl;
+    } else {
+        cout << "Test Failed: Heap not rebuilt correctly with new priority function." << endl;
+    }
+    
+    PQueue emptyQueue(priorityFn2, MINHEAP, LEFTIST);
+    PQueue populatedQueue(priorityFn2, MINHEAP, LEFTIST);
+    
+    PQueue queueOne(priorityFn2, MINHEAP, LEFTIST);
+    PQueue queueTwo(priorityFn2, MINHEAP, LEFTIST);
+
+    for (int i = 0; i < 10; i++){
+        Patient patient(nameDB[nameGen.getRandNum()],
+                    temperatureGen.getRandNum(),
+                    oxygenGen.getRandNum(),
+                    respiratoryGen.getRandNum(),
+                    bloodPressureGen.getRandNum(),
+                    nurseOpinionGen.getRandNum());
+        populatedQueue.insertPatient(patient);
+        queueOne.insertPatient(patient);
+    }
+    
+    if (tester.testMergeEmptyQueue(emptyQueue, populatedQueue)) {
+        cout << "Test Passed: Merge with empty queue successful." << endl;
+        
+    } else {
+        cout << "Test Failed: Merge with empty queue unsuccessful." << endl;
+    }
+    
+    PQueue queueThree(priorityFn2, MINHEAP, LEFTIST);
+    for (int i = 0; i < 10; i++){
+        Patient patient(nameDB[nameGen.getRandNum()],
+                    temperatureGen.getRandNum(),
+                    oxygenGen.getRandNum(),
+                    respiratoryGen.getRandNum(),
+                    bloodPressureGen.getRandNum(),
+                    nurseOpinionGen.getRandNum());
+        
+        queueThree.insertPatient(patient);
+    }
+    
+    PQueue queueFour(queueThree);
+    if (tester.testCopyConstructorEdge(queueThree, queueFour)){
+        cout << "Normal Test Passed: The copy constructor successfully makes a deep copy." << endl;
+    } else {
+        cout << "Normal Test Passed: The copy constructor fail to make a deep copy." << endl;
+    }
+    
+    PQueue queueFive(priorityFn2, MINHEAP, LEFTIST);
+    PQueue queueSix(queueFive);
+    
+    if (tester.testCopyConstructorEdge(queueThree, queueFour)){
+        cout << "Edge Test Passed: The copy constructor successfully makes a deep copy." << endl;
     } else {
         cout << "Edge Test Passed: The copy constructor fail to make a deep copy." << endl;
     }
@@ -618,6 +1990,215 @@ int main(){
         cout << "Test failed: No exception thrown for merging queues with different priority functions." << endl;
     }
     
+    PQueue skewQueue(priorityFn1, MAXHEAP, SKEW);
+    for (int i = 0; i < 300; i++){
+        Patient patient(nameDB[nameGen.getRandNum()],
+                    temperatureGen.getRandNum(),
+                    oxygenGen.getRandNum(),
+                    respiratoryGen.getRandNum(),
+                    bloodPressureGen.getRandNum(),
+                    nurseOpinionGen.getRandNum());
+        skewQueue.insertPatient(patient);
+    }
+    
+    if (tester.testSetStructure(skewQueue)) {
+        cout << "Test passed: Skew heap rebuilt correctly as a leftist heap." << endl;
+        
+    } else {
+        cout << "Test failed: Skew heap not rebuilt correctly as a leftist heap." << endl;
+    }
+    
+    vector<Patient> waitingRoom;
+    for (int i = 0; i < 300; i++){
+        Patient patient(nameDB[nameGen.getRandNum()],
+                    temperatureGen.getRandNum(),
+                    oxygenGen.getRandNum(),
+                    respiratoryGen.getRandNum(),
+                    bloodPressureGen.getRandNum(),
+                    nurseOpinionGen.getRandNum());
+        waitingRoom.push_back(patient);
+    }
+    
+    if (tester.testBulkLoad(waitingRoom, LEFTIST, MINHEAP, priorityFn2) &&
+        tester.testBulkLoad(waitingRoom, SKEW, MAXHEAP, priorityFn1)) {
+        cout << "Test passed: Queues bulk-loaded from a range of patients are valid heaps." << endl;
+        
+    } else {
+        cout << "Test failed: Queues bulk-loaded from a range of patients are not valid heaps." << endl;
+    }
+    
+    PQueue movingQueue(waitingRoom.begin(), waitingRoom.end(), priorityFn2, MINHEAP, LEFTIST);
+    if (tester.testMoveSemantics(movingQueue)) {
+        cout << "Test passed: Queues and patients are moved without losing patients." << endl;
+        
+    } else {
+        cout << "Test failed: Moving queues or patients loses patients." << endl;
+    }
+    
+    if (tester.testCompactPatient()) {
+        cout << "Test passed: The compact patient record keeps every value." << endl;
+        
+    } else {
+        cout << "Test failed: The compact patient record loses values." << endl;
+    }
+    
+    if (tester.testDaryHeap(waitingRoom, DEFAULTARITY) && tester.testDaryHeap(waitingRoom, 2) &&
+        tester.testDaryHeap(waitingRoom, 7)) {
+        cout << "Test passed: D-ary heaps keep the heap property and drain in priority order." << endl;
+        
+    } else {
+        cout << "Test failed: D-ary heaps lose the heap property." << endl;
+    }
+    
+    if (tester.testPairingHeap(waitingRoom)) {
+        cout << "Test passed: Pairing heaps keep the heap property and drain in priority order." << endl;
+        
+    } else {
+        cout << "Test failed: Pairing heaps lose the heap property." << endl;
+    }
+    
+    if (tester.testGetNextPatients(waitingRoom, SKEW) && tester.testGetNextPatients(waitingRoom, LEFTIST) &&
+        tester.testGetNextPatients(waitingRoom, BUCKET) && tester.testGetNextPatients(waitingRoom, DARY) &&
+        tester.testGetNextPatients(waitingRoom, PAIRING)) {
+        cout << "Test passed: Batches of patients are dequeued in priority order." << endl;
+        
+    } else {
+        cout << "Test failed: Batches of patients are not dequeued in priority order." << endl;
+    }
+    
+    if (tester.testPeekTopK(waitingRoom, SKEW) && tester.testPeekTopK(waitingRoom, LEFTIST) &&
+        tester.testPeekTopK(waitingRoom, BUCKET) && tester.testPeekTopK(waitingRoom, DARY) &&
+        tester.testPeekTopK(waitingRoom, PAIRING)) {
+        cout << "Test passed: The queue is iterated in priority order without changing it." << endl;
+        
+    } else {
+        cout << "Test failed: The queue is not iterated in priority order." << endl;
+    }
+    
+    if (tester.testHandles(waitingRoom, SKEW) && tester.testHandles(waitingRoom, LEFTIST) &&
+        tester.testHandles(waitingRoom, BUCKET) && tester.testHandles(waitingRoom, DARY) &&
+        tester.testHandles(waitingRoom, PAIRING)) {
+        cout << "Test passed: Patients are updated and removed through their handles." << endl;
+        
+    } else {
+        cout << "Test failed: Patients are not updated or removed correctly through their handles." << endl;
+    }
+    
+    if (tester.testMergedHandles(waitingRoom, SKEW, false) && tester.testMergedHandles(waitingRoom, LEFTIST, false) &&
+        tester.testMergedHandles(waitingRoom, BUCKET, false) && tester.testMergedHandles(waitingRoom, DARY, false) &&
+        tester.testMergedHandles(waitingRoom, PAIRING, false) && tester.testMergedHandles(waitingRoom, SKEW, true) &&
+        tester.testMergedHandles(waitingRoom, LEFTIST, true) && tester.testMergedHandles(waitingRoom, PAIRING, true)) {
+        cout << "Test passed: Handles follow their patients into the queue they were merged into." << endl;
+        
+    } else {
+        cout << "Test failed: Handles of a merged queue are still accepted by the emptied queue." << endl;
+    }
+    
+    if (tester.testLazyMerge(waitingRoom, SKEW) && tester.testLazyMerge(waitingRoom, LEFTIST) &&
+        tester.testLazyMerge(waitingRoom, PAIRING)) {
+        cout << "Test passed: Lazy merges are deferred and melded by the first dequeue." << endl;
+        
+    } else {
+        cout << "Test failed: Lazy merges lose patients or break the priority order." << endl;
+    }
+    
+    if (tester.testMergeAll(waitingRoom, SKEW) && tester.testMergeAll(waitingRoom, LEFTIST) &&
+        tester.testMergeAll(waitingRoom, BUCKET) && tester.testMergeAll(waitingRoom, DARY) &&
+        tester.testMergeAll(waitingRoom, PAIRING)) {
+        cout << "Test passed: Many queues of mixed structures are merged at once." << endl;
+        
+    } else {
+        cout << "Test failed: Merging many queues at once loses patients or accepts bad inputs." << endl;
+    }
+    
+    if (tester.testSnapshot(waitingRoom, SKEW) && tester.testSnapshot(waitingRoom, LEFTIST) &&
+        tester.testSnapshot(waitingRoom, BUCKET) && tester.testSnapshot(waitingRoom, DARY) &&
+        tester.testSnapshot(waitingRoom, PAIRING)) {
+        cout << "Test passed: Snapshots restore the queue and reject damaged files." << endl;
+        
+    } else {
+        cout << "Test failed: Snapshots don't restore the queue or accept damaged files." << endl;
+    }
+    
+    if (tester.testPatientFeed(waitingRoom)) {
+        cout << "Test passed: Patient feeds queue the valid rows and report the bad ones." << endl;
+        
+    } else {
+        cout << "Test failed: Patient feeds lose valid rows or queue bad ones." << endl;
+    }
+    
+    if (tester.testStats(waitingRoom, SKEW) && tester.testStats(waitingRoom, LEFTIST) &&
+        tester.testStats(waitingRoom, BUCKET) && tester.testStats(waitingRoom, DARY) &&
+        tester.testStats(waitingRoom, PAIRING)) {
+        cout << "Test passed: Statistics describe the shape of the heap and count operations when enabled." << endl;
+        
+    } else {
+        cout << "Test failed: Statistics don't match the heap or count operations when disabled." << endl;
+    }
+    
+    if (tester.testCancelPatient(waitingRoom, SKEW) && tester.testCancelPatient(waitingRoom, LEFTIST) &&
+        tester.testCancelPatient(waitingRoom, BUCKET) && tester.testCancelPatient(waitingRoom, DARY) &&
+        tester.testCancelPatient(waitingRoom, PAIRING)) {
+        cout << "Test passed: Cancelled patients are skipped and compacted away." << endl;
+        
+    } else {
+        cout << "Test failed: Cancelled patients are returned or never compacted." << endl;
+    }
+    
+    if (tester.testConcurrentPQueue(waitingRoom)) {
+        cout << "Test passed: The concurrent queue keeps every patient inserted by two threads." << endl;
+        
+    } else {
+        cout << "Test failed: The concurrent queue loses patients inserted by two threads." << endl;
+    }
+    
+    if (tester.testLatencyHistogram(waitingRoom)) {
+        cout << "Test passed: Latency histograms report percentiles of every recorded operation." << endl;
+        
+    } else {
+        cout << "Test failed: Latency histograms lose latencies or misreport percentiles." << endl;
+    }
+    
+    if (tester.testPersistentPQueue(waitingRoom)) {
+        cout << "Test passed: Persistent queues share their nodes and keep every version." << endl;
+        
+    } else {
+        cout << "Test failed: Persistent queues copy too much or change older versions." << endl;
+    }
+    
+    if (tester.testFifoTies(waitingRoom, SKEW) && tester.testFifoTies(waitingRoom, LEFTIST) &&
+        tester.testFifoTies(waitingRoom, BUCKET) && tester.testFifoTies(waitingRoom, DARY) &&
+        tester.testFifoTies(waitingRoom, PAIRING)) {
+        cout << "Test passed: Patients of equal priority are served first-come-first-served." << endl;
+        
+    } else {
+        cout << "Test failed: Patients of equal priority leave out of arrival order." << endl;
+    }
+    
+    if (tester.testBucketQueue(waitingRoom)) {
+        cout << "Test passed: Bucket queues drain in priority order with their overflow heap." << endl;
+        
+    } else {
+        cout << "Test failed: Bucket queues do not drain in priority order." << endl;
+    }
+    
+    PQueue spineOne(priorityFn2, MINHEAP, SKEW);
+    PQueue spineTwo(priorityFn2, MINHEAP, SKEW);
+    if (tester.testLongRightSpine(spineOne, spineTwo, 500000)) {
+        cout << "Test passed: Skew heaps with long right spines merge and copy without recursion." << endl;
+        
+    } else {
+        cout << "Test failed: Skew heaps with long right spines are not merged or copied correctly." << endl;
+    }
+    
+    PQueue poolQueue(priorityFn2, MINHEAP, SKEW);
+    if (tester.testNodePoolRecycle(poolQueue, 1000)) {
+        cout << "Test passed: The node pool recycles nodes without growing." << endl;
+        
+    } else {
+        cout << "Test failed: The node pool grows when it has free nodes." << endl;
+    }
+    
     return 0;
 }
 
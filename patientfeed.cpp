@@ -0,0 +1,279 @@
+/**********************************************
+ ** File: patientfeed.cpp
+ ** Project: CMSC 341 Project 3, Fall 2023
+ ** Author: Joshua Hur
+ ** Date: 11/14/23
+ ** Section: 2
+ ** E-mail: jhur1@umbc.edu
+ **
+ ** This file implements the patient feed reader declared in patientfeed.h.
+ ************************************************************************/
+
+#include "patientfeed.h"
+#include <fstream>
+
+// Parse errors of a row, FEEDNUMBER + field when a vital is not a number
+const int FEEDOK = 0;
+const int FEEDFIELDS = 1;
+const int FEEDTRUNCATED = 2;
+const int FEEDNUMBER = 8;
+
+// Triage bounds and names of the vitals, in the order of a feed row
+const int FEEDMIN[5] = {MINTEMP, MINOX, MINRR, MINBP, MINOPINION};
+const int FEEDMAX[5] = {MAXTEMP, MAXOX, MAXRR, MAXBP, MAXOPINION};
+const char* const FEEDFIELD[5] = {"temperature", "oxygen", "respiratory rate", "blood pressure", "nurse opinion"};
+
+// PatientFeed(const string& path, FEEDFORMAT format, int chunkSize, int batchSize)
+// The constructor only records the feed, the file is opened by readInto
+PatientFeed::PatientFeed(const string& path, FEEDFORMAT format, int chunkSize, int batchSize) {
+    if (chunkSize < 1 || batchSize < 1) {
+        throw domain_error("The chunk and batch sizes must be positive.");
+    }
+    m_path = path;
+    m_format = format;
+    m_chunkSize = chunkSize;
+    m_batchSize = batchSize;
+    m_numRows = 0;
+}
+
+// readInto(PQueue& queue)
+// Read every row of the feed, queue the valid patients and keep the rejected rows
+int PatientFeed::readInto(PQueue& queue) {
+    ifstream file(m_path, ios::binary);
+    if (!file) {
+        throw runtime_error("Cannot open the patient feed " + m_path + ".");
+    }
+    m_numRows = 0;
+    m_rejections.clear();
+    m_batch.reserve(m_batchSize);
+
+    int queued = (m_format == CSVFEED) ? readCSV(file, queue) : readBinary(file, queue);
+    return queued + flushBatch(queue);
+}
+
+// numRows() const
+// Return the number of rows read, blank lines and the CSV header are not rows
+long long PatientFeed::numRows() const {
+    return m_numRows;
+}
+
+// getRejections() const
+// Return the rows that were not queued, in the order of the feed
+const vector<FeedRejection>& PatientFeed::getRejections() const {
+    return m_rejections;
+}
+
+// writeBinary(const string& path, const vector<Patient>& patients)
+// Write patients as fixed-size binary records
+void PatientFeed::writeBinary(const string& path, const vector<Patient>& patients) {
+    ofstream file(path, ios::binary | ios::trunc);
+    char record[FEEDRECORDSIZE];
+    for (const Patient& patient : patients) {
+        memcpy(record, patient.m_patient, MAXNAME + 1);
+        record[MAXNAME + 1] = (char) patient.m_temperature;
+        record[MAXNAME + 2] = (char) patient.m_oxygen;
+        record[MAXNAME + 3] = (char) patient.m_RR;
+        record[MAXNAME + 4] = (char) patient.m_BP;
+        record[MAXNAME + 5] = (char) patient.m_opinion;
+        file.write(record, FEEDRECORDSIZE);
+    }
+    if (!file) {
+        throw runtime_error("Cannot write the patient feed " + path + ".");
+    }
+}
+
+// readCSV(istream& file, PQueue& queue)
+// Read the file a chunk at a time and parse the complete lines in place. The partial line
+// at the end of a chunk moves to the front of the buffer, which doubles if a single line
+// does not fit in it
+int PatientFeed::readCSV(istream& file, PQueue& queue) {
+    vector<char> buffer(m_chunkSize);
+    size_t carry = 0;
+    long long line = 0;
+    int queued = 0;
+    bool atEnd = false;
+
+    while (!atEnd) {
+        if (carry == buffer.size()) {
+            buffer.resize(2 * buffer.size());
+        }
+        file.read(buffer.data() + carry, buffer.size() - carry);
+        size_t filled = carry + file.gcount();
+        atEnd = filled < buffer.size();
+
+        const char* start = buffer.data();
+        const char* end = start + filled;
+        while (start < end) {
+            const char* newline = (const char*) memchr(start, '\n', end - start);
+            if (!newline && !atEnd) {
+                break;
+            }
+            const char* lineEnd = newline ? newline : end;
+            line++;
+            if (lineEnd > start && lineEnd[-1] == '\r') {
+                parseLine(start, lineEnd - 1, line);
+            } else {
+                parseLine(start, lineEnd, line);
+            }
+            start = newline ? newline + 1 : end;
+        }
+
+        // The names of the parsed rows point into the buffer, they are used up before it moves
+        queued += flushRows(queue);
+        carry = end - start;
+        memmove(buffer.data(), start, carry);
+    }
+    return queued;
+}
+
+// readBinary(istream& file, PQueue& queue)
+// Read whole records a chunk at a time, a short record at the end of the file is rejected
+int PatientFeed::readBinary(istream& file, PQueue& queue) {
+    int chunkRecords = max(1, m_chunkSize / FEEDRECORDSIZE);
+    vector<char> buffer((size_t) chunkRecords * FEEDRECORDSIZE);
+    long long record = 0;
+    int queued = 0;
+
+    while (file) {
+        file.read(buffer.data(), buffer.size());
+        size_t filled = file.gcount();
+        for (size_t offset = 0; offset + FEEDRECORDSIZE <= filled; offset += FEEDRECORDSIZE) {
+            parseRecord(buffer.data() + offset, ++record);
+        }
+        if (filled % FEEDRECORDSIZE != 0) {
+            FeedRow row = {};
+            row.m_error = FEEDTRUNCATED;
+            row.m_row = ++record;
+            m_rows.push_back(row);
+        }
+        queued += flushRows(queue);
+    }
+    return queued;
+}
+
+// parseLine(const char* line, const char* end, long long lineNumber)
+// Split a CSV line into the name and five vitals without copying it. Blank lines and a
+// "name,..." header on the first line are skipped
+void PatientFeed::parseLine(const char* line, const char* end, long long lineNumber) {
+    if (line == end || (lineNumber == 1 && end - line >= 5 && memcmp(line, "name,", 5) == 0)) {
+        return;
+    }
+
+    FeedRow row = {};
+    row.m_row = lineNumber;
+    row.m_error = FEEDOK;
+    const char* comma = (const char*) memchr(line, ',', end - line);
+    if (!comma) {
+        row.m_error = FEEDFIELDS;
+        m_rows.push_back(row);
+        return;
+    }
+    row.m_name = line;
+    row.m_nameLength = comma - line;
+
+    const char* field = comma + 1;
+    for (int vital = 0; vital < 5 && row.m_error == FEEDOK; vital++) {
+        const char* fieldEnd = (const char*) memchr(field, ',', end - field);
+        if ((vital < 4 && !fieldEnd) || (vital == 4 && fieldEnd)) {
+            row.m_error = FEEDFIELDS;
+            break;
+        }
+        if (!fieldEnd) {
+            fieldEnd = end;
+        }
+
+        // At most nine digits, so the value cannot overflow
+        int value = 0;
+        if (fieldEnd == field || fieldEnd - field > 9) {
+            row.m_error = FEEDNUMBER + vital;
+        }
+        for (const char* digit = field; digit < fieldEnd && row.m_error == FEEDOK; digit++) {
+            if (*digit < '0' || *digit > '9') {
+                row.m_error = FEEDNUMBER + vital;
+            }
+            value = 10 * value + (*digit - '0');
+        }
+        row.m_vitals[vital] = value;
+        field = fieldEnd + 1;
+    }
+    m_rows.push_back(row);
+}
+
+// parseRecord(const char* record, long long recordNumber)
+// Read the name and the vitals of a binary record, a name without a terminator is cut
+void PatientFeed::parseRecord(const char* record, long long recordNumber) {
+    FeedRow row;
+    row.m_name = record;
+    row.m_nameLength = (int) strnlen(record, MAXNAME + 1);
+    for (int vital = 0; vital < 5; vital++) {
+        row.m_vitals[vital] = (unsigned char) record[MAXNAME + 1 + vital];
+    }
+    row.m_error = FEEDOK;
+    row.m_row = recordNumber;
+    m_rows.push_back(row);
+}
+
+// flushRows(PQueue& queue)
+// Check the vitals of every parsed row against the triage bounds in one pass, then move
+// the valid rows into the batch and report the others. Return the number of patients queued
+int PatientFeed::flushRows(PQueue& queue) {
+
+    // One bit per vital out of range, computed without a branch per field
+    vector<unsigned int> outOfRange(m_rows.size());
+    for (size_t i = 0; i < m_rows.size(); i++) {
+        unsigned int mask = 0;
+        for (int vital = 0; vital < 5; vital++) {
+            unsigned int offset = (unsigned int) (m_rows[i].m_vitals[vital] - FEEDMIN[vital]);
+            mask |= (unsigned int) (offset > (unsigned int) (FEEDMAX[vital] - FEEDMIN[vital])) << vital;
+        }
+        outOfRange[i] = mask;
+    }
+
+    int queued = 0;
+    for (size_t i = 0; i < m_rows.size(); i++) {
+        const FeedRow& row = m_rows[i];
+        if (row.m_error == FEEDFIELDS) {
+            m_rejections.push_back({row.m_row, "expected 6 fields"});
+        } else if (row.m_error == FEEDTRUNCATED) {
+            m_rejections.push_back({row.m_row, "truncated record"});
+        } else if (row.m_error >= FEEDNUMBER) {
+            m_rejections.push_back({row.m_row, string(FEEDFIELD[row.m_error - FEEDNUMBER]) + " is not a number"});
+        } else if (row.m_nameLength == 0) {
+            m_rejections.push_back({row.m_row, "empty name"});
+        } else if (outOfRange[i]) {
+            int vital = __builtin_ctz(outOfRange[i]);
+            m_rejections.push_back({row.m_row, string(FEEDFIELD[vital]) + " " + to_string(row.m_vitals[vital]) +
+                                               " out of range " + to_string(FEEDMIN[vital]) + "-" +
+                                               to_string(FEEDMAX[vital])});
+        } else {
+            // The fields are set directly, they were checked above
+            m_batch.emplace_back();
+            Patient& patient = m_batch.back();
+            int length = min(row.m_nameLength, MAXNAME);
+            memcpy(patient.m_patient, row.m_name, length);
+            memset(patient.m_patient + length, 0, MAXNAME + 1 - length);
+            patient.m_temperature = row.m_vitals[0];
+            patient.m_oxygen = row.m_vitals[1];
+            patient.m_RR = row.m_vitals[2];
+            patient.m_BP = row.m_vitals[3];
+            patient.m_opinion = row.m_vitals[4];
+            if ((int) m_batch.size() == m_batchSize) {
+                queued += flushBatch(queue);
+            }
+        }
+    }
+    m_numRows += m_rows.size();
+    m_rows.clear();
+    return queued;
+}
+
+// flushBatch(PQueue& queue)
+// Queue the batch with a single heapify and return its size
+int PatientFeed::flushBatch(PQueue& queue) {
+    int count = (int) m_batch.size();
+    if (count > 0) {
+        queue.insertPatients(m_batch.begin(), m_batch.end());
+        m_batch.clear();
+    }
+    return count;
+}
@@ -0,0 +1,75 @@
+/**********************************************
+ ** File: patientfeed.h
+ ** Project: CMSC 341 Project 3, Fall 2023
+ ** Author: Joshua Hur
+ ** Date: 11/14/23
+ ** Section: 2
+ ** E-mail: jhur1@umbc.edu
+ **
+ ** This file contains the reader for the patient feeds pushed by the intake systems.
+ ** A feed is either a CSV text file, one "name,temperature,oxygen,RR,BP,opinion" row
+ ** per line, or a binary file of fixed-size records. The file is read in chunks and
+ ** parsed in place, the vitals of a whole chunk are checked against the triage
+ ** bounds at once, and the valid patients are queued in batches. Rows that fail
+ ** are reported instead of being queued as EMPTY patients.
+ ************************************************************************/
+
+#ifndef PATIENTFEED_H
+#define PATIENTFEED_H
+
+#include "pqueue.h"
+
+enum FEEDFORMAT {CSVFEED, BINARYFEED};
+// Binary record: the name in MAXNAME + 1 bytes, zero padded, then one byte each
+// for the temperature, oxygen, respiratory rate, blood pressure and nurse opinion
+const int FEEDRECORDSIZE = MAXNAME + 6;
+const int DEFAULTCHUNK = 1 << 20;  // Bytes read from the file at a time
+const int DEFAULTBATCH = 4096;     // Valid patients queued with one insertPatients
+
+// A row of the feed that was not queued
+struct FeedRejection {
+    long long m_row;    // line of a CSV feed or record of a binary feed, from 1
+    string m_reason;    // what is wrong with the row
+};
+
+class PatientFeed {
+public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // contains test functions
+    PatientFeed(const string& path, FEEDFORMAT format, int chunkSize = DEFAULTCHUNK, int batchSize = DEFAULTBATCH);
+    // Read the whole feed into queue and return the number of patients queued
+    // Throws runtime_error if the file cannot be opened
+    int readInto(PQueue& queue);
+    long long numRows() const;  // rows read so far, queued or rejected
+    const vector<FeedRejection>& getRejections() const;
+    // Write patients as a binary feed
+    static void writeBinary(const string& path, const vector<Patient>& patients);
+
+private:
+    // A parsed row, the name still points into the chunk buffer
+    struct FeedRow {
+        const char* m_name;
+        int m_nameLength;
+        int m_vitals[5];    // temperature, oxygen, RR, BP, opinion
+        int m_error;        // parse error, FEEDOK when the row was read
+        long long m_row;
+    };
+
+    string m_path;
+    FEEDFORMAT m_format;
+    int m_chunkSize;
+    int m_batchSize;
+    long long m_numRows;
+    vector<FeedRejection> m_rejections;
+    vector<FeedRow> m_rows;     // rows of the current chunk
+    vector<Patient> m_batch;    // valid patients not queued yet
+
+    int readCSV(istream& file, PQueue& queue);
+    int readBinary(istream& file, PQueue& queue);
+    void parseLine(const char* line, const char* end, long long lineNumber);
+    void parseRecord(const char* record, long long recordNumber);
+    int flushRows(PQueue& queue);
+    int flushBatch(PQueue& queue);
+};
+
+#endif
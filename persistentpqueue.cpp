@@ -0,0 +1,242 @@
+/**********************************************
+ ** File: persistentpqueue.cpp
+ ** Project: CMSC 341 Project 3, Fall 2023
+ ** Author: Joshua Hur
+ ** Date: 11/14/23
+ ** Section: 2
+ ** E-mail: jhur1@umbc.edu
+ **
+ ** This file implements the persistent priority queue declared in persistentpqueue.h.
+ ************************************************************************/
+
+#include "persistentpqueue.h"
+
+// PersistentPQueue(prifn_t priFn, HEAPTYPE heapType)
+// Create an empty queue
+PersistentPQueue::PersistentPQueue(prifn_t priFn, HEAPTYPE heapType) {
+    m_size = 0;
+    m_priorFunc = priFn;
+    m_heapType = heapType;
+    m_arrivals = 0;
+}
+
+// snapshot() const
+// Return a version that later changes of this queue do not affect, in O(1)
+PersistentPQueue PersistentPQueue::snapshot() const {
+    return *this;
+}
+
+// insertPatient(const Patient& patient)
+// Merge a one-node heap into this version, numbered after every patient it already has
+void PersistentPQueue::insertPatient(const Patient& patient) {
+    if (m_arrivals == 0xFFFFFFFFu) {
+        renumberArrivals();
+    }
+    NodePtr node = make_shared<PNode>(patient, packKey(m_priorFunc(patient), m_arrivals++), nullptr, nullptr);
+    m_heap = merge(m_heap, node);
+    m_size++;
+}
+
+// getNextPatient()
+// Replace the root of this version by the merge of its children; the old root and
+// everything below it stay valid for the other versions
+Patient PersistentPQueue::getNextPatient() {
+    if (m_size == 0) {
+        throw out_of_range("The queue is empty.");
+    }
+    Patient patient = m_heap -> m_patient;
+    m_heap = merge(m_heap -> m_left, m_heap -> m_right);
+    m_size--;
+    return patient;
+}
+
+// getTop() const
+// Return the highest priority patient without removing it
+const Patient& PersistentPQueue::getTop() const {
+    if (m_size == 0) {
+        throw out_of_range("The queue is empty.");
+    }
+    return m_heap -> m_patient;
+}
+
+// mergeWithQueue(const PersistentPQueue& rhs)
+// Merge the heap of rhs into this version, both heaps keep their own nodes
+void PersistentPQueue::mergeWithQueue(const PersistentPQueue& rhs) {
+    if (m_priorFunc != rhs.m_priorFunc || m_heapType != rhs.m_heapType) {
+        throw domain_error("Queues have different priority functions or heap types.");
+    }
+    // Merging a version with itself doubles its patients, the nodes are shared twice
+    m_heap = merge(m_heap, rhs.m_heap);
+    m_size += rhs.m_size;
+    
+    // Both versions numbered their arrivals from 0, equal numbers keep no order between them
+    m_arrivals = max(m_arrivals, rhs.m_arrivals);
+}
+
+// clear()
+// Drop this version, the nodes go away with the last version that uses them
+void PersistentPQueue::clear() {
+    m_heap.reset();
+    m_size = 0;
+    m_arrivals = 0;
+}
+
+// numPatients() const
+// Return the number of patients in this version
+int PersistentPQueue::numPatients() const {
+    return m_size;
+}
+
+// getPriorityFn() const
+// Return the priority function
+prifn_t PersistentPQueue::getPriorityFn() const {
+    return m_priorFunc;
+}
+
+// getHeapType() const
+// Return the type of the heap
+HEAPTYPE PersistentPQueue::getHeapType() const {
+    return m_heapType;
+}
+
+// printPatientQueue() const
+// Print the patients of this version in preorder
+void PersistentPQueue::printPatientQueue() const {
+    vector<const PNode*> stack;
+    if (m_heap) {
+        stack.push_back(m_heap.get());
+    }
+    while (!stack.empty()) {
+        const PNode* node = stack.back();
+        stack.pop_back();
+        cout << "[" << node -> getKey() << "] " << node -> m_patient << endl;
+        if (node -> m_right) stack.push_back(node -> m_right.get());
+        if (node -> m_left) stack.push_back(node -> m_left.get());
+    }
+}
+
+// dump() const
+// Visualize the heap of this version
+void PersistentPQueue::dump() const {
+    if (m_size == 0) {
+        cout << "Empty heap.\n";
+    } else {
+        dump(m_heap.get());
+    }
+    cout << endl;
+}
+
+// merge(const NodePtr& a, const NodePtr& b) const
+// Return a new heap with the nodes of a and b. Only the nodes on the merge path are
+// copied, the rest of both heaps is shared. The path follows right spines, so the
+// recursion is O(log n) deep
+PersistentPQueue::NodePtr PersistentPQueue::merge(const NodePtr& a, const NodePtr& b) const {
+    if (!a) return b;
+    if (!b) return a;
+    if (isHigher(b.get(), a.get())) {
+        return merge(b, a);
+    }
+    return make_shared<PNode>(a -> m_patient, a -> m_key, a -> m_left, merge(a -> m_right, b));
+}
+
+// isHigher(const PNode* a, const PNode* b) const
+// Check node 'a' has strictly higher priority than node 'b', of two equal priorities the
+// one that arrived first
+bool PersistentPQueue::isHigher(const PNode* a, const PNode* b) const {
+    if (m_heapType == MAXHEAP) {
+        return a -> m_key > b -> m_key;
+    }
+    return a -> m_key < b -> m_key;
+}
+
+// packKey(int priority, unsigned int arrival) const
+// Pack a priority and an arrival number into a key the same way PQueue does, a max-heap
+// inverts the arrival so the earlier of two equal priorities still has the higher key
+unsigned long long PersistentPQueue::packKey(int priority, unsigned int arrival) const {
+    unsigned int tieMask = (m_heapType == MAXHEAP) ? 0xFFFFFFFFu : 0;
+    return ((unsigned long long) ((unsigned int) priority ^ KEYSIGN) << 32) | (arrival ^ tieMask);
+}
+
+// arrivalOf(const PNode* node) const
+// Return the arrival number packed in the key of a node
+unsigned int PersistentPQueue::arrivalOf(const PNode* node) const {
+    unsigned int tieMask = (m_heapType == MAXHEAP) ? 0xFFFFFFFFu : 0;
+    return (unsigned int) node -> m_key ^ tieMask;
+}
+
+// renumberArrivals()
+// Helper function of insertPatient for arrival numbers that are about to wrap: this version
+// is built again with its patients numbered from 0 in arrival order. The other versions keep
+// their nodes
+void PersistentPQueue::renumberArrivals() {
+    vector<const PNode*> nodes;
+    vector<const PNode*> stack;
+    if (m_heap) {
+        stack.push_back(m_heap.get());
+    }
+    while (!stack.empty()) {
+        const PNode* node = stack.back();
+        stack.pop_back();
+        nodes.push_back(node);
+        if (node -> m_right) stack.push_back(node -> m_right.get());
+        if (node -> m_left) stack.push_back(node -> m_left.get());
+    }
+    stable_sort(nodes.begin(), nodes.end(), [this](const PNode* a, const PNode* b) { return arrivalOf(a) < arrivalOf(b); });
+    
+    // The old nodes stay alive until the new heap is built
+    NodePtr heap;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        NodePtr node = make_shared<PNode>(nodes[i] -> m_patient, packKey(nodes[i] -> getKey(), (unsigned int) i), nullptr, nullptr);
+        heap = merge(heap, node);
+    }
+    m_heap = move(heap);
+    m_arrivals = (unsigned int) nodes.size();
+}
+
+// getNPL(const NodePtr& node)
+// Return the null path length of a node, -1 for an empty heap
+int PersistentPQueue::getNPL(const NodePtr& node) {
+    return node ? node -> m_npl : -1;
+}
+
+// dump(const PNode* pos) const
+// Helper function of dump() that prints a subtree in order with the null path lengths
+void PersistentPQueue::dump(const PNode* pos) const {
+    if (pos != nullptr) {
+        cout << "(";
+        dump(pos -> m_left.get());
+        cout << pos -> getKey() << ":" << pos -> m_patient.getPatient() << ":" << pos -> m_npl;
+        dump(pos -> m_right.get());
+        cout << ")";
+    }
+}
+
+// PNode(const Patient& patient, unsigned long long key, NodePtr left, NodePtr right)
+// Create a node with the child of the higher null path length on the left
+PersistentPQueue::PNode::PNode(const Patient& patient, unsigned long long key, NodePtr left, NodePtr right)
+    : m_patient(patient), m_key(key) {
+    if (getNPL(right) > getNPL(left)) {
+        swap(left, right);
+    }
+    m_npl = getNPL(right) + 1;
+    m_left = move(left);
+    m_right = move(right);
+}
+
+// ~PNode()
+// Free the subtrees that only this node holds with an explicit stack, so dropping the
+// last version of a heap with a long left spine does not recurse once per node
+PersistentPQueue::PNode::~PNode() {
+    vector<NodePtr> stack;
+    if (m_left.use_count() == 1) stack.push_back(move(m_left));
+    if (m_right.use_count() == 1) stack.push_back(move(m_right));
+    while (!stack.empty()) {
+        NodePtr node = move(stack.back());
+        stack.pop_back();
+
+        // The last owner of a node may take its children before it is freed
+        PNode* owned = const_cast<PNode*>(node.get());
+        if (owned -> m_left.use_count() == 1) stack.push_back(move(owned -> m_left));
+        if (owned -> m_right.use_count() == 1) stack.push_back(move(owned -> m_right));
+    }
+}
@@ -0,0 +1,82 @@
+/**********************************************
+ ** File: persistentpqueue.h
+ ** Project: CMSC 341 Project 3, Fall 2023
+ ** Author: Joshua Hur
+ ** Date: 11/14/23
+ ** Section: 2
+ ** E-mail: jhur1@umbc.edu
+ **
+ ** This file contains the persistent priority queue for reports, audits and what-if
+ ** triage. Its leftist heap is made of immutable, reference counted nodes that the
+ ** versions of the queue share, so a copy is O(1). An insert, dequeue or merge copies
+ ** only the nodes on its merge path (O(log n) of them, the right spines of a leftist
+ ** heap are short) and leaves every other version as it was. Different threads may
+ ** read and change different copies at the same time; a single copy is not
+ ** synchronized. Skew heaps are not offered: their amortized bound does not survive
+ ** repeated operations on the same old version.
+ ************************************************************************/
+
+#ifndef PERSISTENTPQUEUE_H
+#define PERSISTENTPQUEUE_H
+
+#include "pqueue.h"
+#include <memory>
+
+class PersistentPQueue {
+public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // contains test functions
+    PersistentPQueue(prifn_t priFn, HEAPTYPE heapType);
+    // Copies share every node, so copying and snapshot() are O(1)
+    PersistentPQueue(const PersistentPQueue& rhs) = default;
+    PersistentPQueue& operator=(const PersistentPQueue& rhs) = default;
+    PersistentPQueue(PersistentPQueue&& rhs) noexcept = default;
+    PersistentPQueue& operator=(PersistentPQueue&& rhs) noexcept = default;
+    PersistentPQueue snapshot() const;
+    void insertPatient(const Patient& patient);
+    // Remove and return the highest priority patient of this version
+    // Throws out_of_range if the queue is empty
+    Patient getNextPatient();
+    const Patient& getTop() const;
+    // Add the patients of rhs to this version; rhs is left as it was
+    // Throws domain_error if the queues have different priority functions or heap types
+    void mergeWithQueue(const PersistentPQueue& rhs);
+    void clear();
+    int numPatients() const;
+    prifn_t getPriorityFn() const;
+    HEAPTYPE getHeapType() const;
+    void printPatientQueue() const;
+    void dump() const;  // For debugging purposes.
+
+private:
+    struct PNode;
+    typedef shared_ptr<const PNode> NodePtr;
+
+    // A node is never changed once it is shared, only replaced by a new one
+    struct PNode {
+        Patient m_patient;  // the patient
+        unsigned long long m_key; // priority and arrival number packed as described at KEYSIGN
+        int m_npl;          // null path length
+        NodePtr m_left;     // child with the higher null path length
+        NodePtr m_right;    // child with the lower null path length
+        PNode(const Patient& patient, unsigned long long key, NodePtr left, NodePtr right);
+        ~PNode();
+        int getKey() const {return (int) ((unsigned int) (m_key >> 32) ^ KEYSIGN);}
+    };
+
+    NodePtr m_heap;         // root of this version
+    int m_size;             // number of patients in this version
+    prifn_t m_priorFunc;    // Function to compute priority
+    HEAPTYPE m_heapType;    // either a MINHEAP or a MAXHEAP
+    unsigned int m_arrivals;// arrival number of the next patient of this version
+
+    NodePtr merge(const NodePtr& a, const NodePtr& b) const;
+    bool isHigher(const PNode* a, const PNode* b) const;
+    unsigned long long packKey(int priority, unsigned int arrival) const;
+    unsigned int arrivalOf(const PNode* node) const;
+    void renumberArrivals();
+    static int getNPL(const NodePtr& node);
+    void dump(const PNode* pos) const;
+};
+
+#endif
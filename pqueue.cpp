@@ -13,6 +13,60 @@
  ************************************************************************/
 
 #include "pqueue.h"
+#include "latencyhistogram.h"
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <thread>
+
+// Size of the first slab of the node pool and the largest slab it grows to
+const int MINSLAB = 64;
+const int MAXSLAB = 65536;
+
+// Fewest patients in a round of mergeAll before its pairs are handed to threads
+const int PARALLELMERGE = 65536;
+
+// Snapshot file layout: the header, the root indices, then one record per node.
+// The d-ary array and the bucket lists come first, in their own order, then the
+// trees (the overflow heap of a bucket queue) breadth-first. Children are stored
+// as record indices, so the file doesn't depend on where the nodes lived, and a
+// child always comes after its parent.
+const char SNAPSHOTMAGIC[8] = {'P', 'Q', 'S', 'N', 'A', 'P', 0, 0};
+const uint32_t SNAPSHOTVERSION = 3;
+const uint32_t SNAPSHOTBYTEORDER = 0x01020304;
+const uint64_t SNAPSHOTSEED = 14695981039346656037ULL;  // FNV-1a offset basis
+
+struct SnapshotHeader {
+    char magic[8];          // SNAPSHOTMAGIC
+    uint32_t version;       // SNAPSHOTVERSION
+    uint32_t byteOrder;     // SNAPSHOTBYTEORDER as the writer stored it
+    uint32_t recordSize;    // sizeof(SnapshotRecord) of the writer
+    int32_t heapType;
+    int32_t structure;
+    int32_t arity;
+    int32_t hasKeyRange;
+    int32_t minKey;
+    int32_t maxKey;
+    uint32_t numRoots;      // main heap (or -1) and the pending heaps
+    uint64_t numNodes;      // live patients and tombstones
+    uint64_t numDead;
+    uint64_t checksum;      // of this header with the checksum zeroed, the root indices and the records
+};
+static_assert(sizeof(SnapshotHeader) % 4 == 0, "The snapshot header is checksummed a word at a time");
+
+struct SnapshotRecord {
+    char patient[sizeof(Patient)];  // the bytes of the trivially copyable Patient
+    int32_t left;           // record index of the left child (first child of a pairing heap), -1 for none
+    int32_t right;          // record index of the right child (next sibling of a pairing heap), -1 for none
+    int32_t npl;
+    int32_t key;
+    uint32_t arrival;       // arrival number, orders equal keys
+    int32_t dead;
+};
+static_assert(sizeof(SnapshotRecord) % 4 == 0, "Snapshot records are checksummed a word at a time");
+static_assert(is_trivial<SnapshotRecord>::value, "Snapshot records are read as raw bytes");
 
 // PQueue(prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure)
 // The default constructor with the required initializations
@@ -22,6 +76,27 @@ PQueue::PQueue(prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure) {
     m_priorFunc = priFn;
     m_heapType = heapType;
     m_structure = structure;
+    m_hasKeyRange = false;
+    m_minKey = 0;
+    m_maxKey = 0;
+    m_arity = DEFAULTARITY;
+    m_numDead = 0;
+    m_arrivals = 0;
+    m_maxDeadFraction = DEFAULTDEADFRACTION;
+    m_lazyMerge = false;
+    m_latency = nullptr;
+    
+    // A bucket queue can't be built without knowing its keys
+    if (structure == BUCKET) {
+        throw domain_error("A key range must be declared for a bucket queue.");
+    }
+}
+
+// PQueue(prifn_t priFn, HEAPTYPE heapType, int minKey, int maxKey)
+// The constructor of a bucket queue for the keys in [minKey, maxKey]
+PQueue::PQueue(prifn_t priFn, HEAPTYPE heapType, int minKey, int maxKey)
+    : PQueue(priFn, heapType, SKEW) {
+    setKeyRange(minKey, maxKey);
 }
 
 // ~PQueue()
@@ -31,32 +106,54 @@ PQueue::~PQueue() {
 }
 
 // clear()
-// Clear the queue and deletes all the nodes in the heap, leaving the heap empty
+// Clear the queue and releases all the nodes in the heap, leaving the heap empty
+// Every node lives in the pool, so the whole heap goes away with the slabs
 void PQueue::clear() {
-    clearRecursively(m_heap);
+    m_pool.release();
     m_heap = nullptr;
     m_size = 0;
+    m_numDead = 0;
+    m_arrivals = 0;
+    m_pending.clear();
+    m_dary.clear();
+    resetBuckets();
 }
 
-// clearRecursively(Node* node)
-// Recursive helper function of clear() to deallocates all memory of the heap
-void PQueue::clearRecursively(Node* node) {
-    if (node != nullptr) {
-        clearRecursively(node -> m_left);
-        clearRecursively(node -> m_right);
-        delete node;
+// reserve(int n)
+// Pre-size the node pool so that n patients fit in the queue without growing it
+void PQueue::reserve(int n) {
+    if (n > m_size) {
+        m_pool.reserve(n - m_size);
     }
 }
 
 // PQueue(const PQueue& rhs)
 // The copy constructor makes a deep copy of the rhs object
 PQueue::PQueue(const PQueue& rhs) {
-    m_priorFunc = rhs.m_priorFunc;
-    m_heapType = rhs.m_heapType;
-    m_structure = rhs.m_structure;
     m_heap = nullptr;
     m_size = 0;
-    m_heap = copyRecursively(rhs.m_heap);
+    copyFrom(rhs);
+}
+
+// PQueue(PQueue&& rhs)
+// The move constructor steals the heap and the node pool of rhs, leaving rhs empty
+PQueue::PQueue(PQueue&& rhs) noexcept {
+    m_heap = nullptr;
+    m_size = 0;
+    stealFrom(rhs);
+}
+
+// operator=(PQueue&& rhs)
+// Move assignment operator releases this heap and steals the heap and the node pool of rhs
+PQueue& PQueue::operator=(PQueue&& rhs) noexcept {
+    
+    // Check for self-assignment
+    if (this != &rhs) {
+        clear();
+        stealFrom(rhs);
+    }
+    
+    return *this;
 }
 
 // operator=(const PQueue& rhs)
@@ -66,41 +163,191 @@ PQueue& PQueue::operator=(const PQueue& rhs) {
     // Check for self-assignment
     if (this != &rhs) {
         clear();
-        m_priorFunc = rhs.m_priorFunc;
-        m_heapType = rhs.m_heapType;
-        m_structure = rhs.m_structure;
-        m_heap = copyRecursively(rhs.m_heap);
-        m_size = rhs.m_size;
+        copyFrom(rhs);
     }
     
     return *this;
 }
 
-// copyRecursively(Node* node)
-// Recursive helper function of PQueue(const PQueue& rhs) and operator=(const PQueue& rhs)
-// that performs an exact same copy of rhs
-Node* PQueue::copyRecursively(Node* node) {
+// copyFrom(const PQueue& rhs)
+// Helper function of PQueue(const PQueue& rhs) and operator=(const PQueue& rhs) that copies
+// the settings and every patient of rhs into this empty queue
+void PQueue::copyFrom(const PQueue& rhs) {
+    m_priorFunc = rhs.m_priorFunc;
+    m_heapType = rhs.m_heapType;
+    m_structure = rhs.m_structure;
+    m_hasKeyRange = rhs.m_hasKeyRange;
+    m_minKey = rhs.m_minKey;
+    m_maxKey = rhs.m_maxKey;
+    m_arity = rhs.m_arity;
+    m_maxDeadFraction = rhs.m_maxDeadFraction;
+    m_lazyMerge = rhs.m_lazyMerge;
+    m_latency = rhs.m_latency;
+    m_pool.reserve(rhs.m_size + rhs.m_numDead);
+    m_heap = copyHeap(rhs.m_heap);
+    for (Node* pending : rhs.m_pending) {
+        m_pending.push_back(copyHeap(pending));
+    }
+    
+    // The d-ary array is copied slot by slot, so the copy has the same shape
+    m_dary = rhs.m_dary;
+    for (DaryEntry& entry : m_dary) {
+        entry.node = copyNode(entry.node);
+    }
+    
+    // Copy the buckets list by list to keep the arrival order in each of them
+    resetBuckets();
+    for (size_t bucket = 0; bucket < rhs.m_bucketHead.size(); bucket++) {
+        for (Node* node = rhs.m_bucketHead[bucket]; node; node = node -> m_left) {
+            pushBucket(copyNode(node));
+        }
+    }
+    m_size = rhs.m_size;
+    m_numDead = rhs.m_numDead;
+    m_arrivals = rhs.m_arrivals;
+}
+
+// stealFrom(PQueue& rhs)
+// Helper function of the move constructor and move assignment that takes over
+// the settings, the heap, the buckets and the node pool of rhs in O(1)
+void PQueue::stealFrom(PQueue& rhs) {
+    m_priorFunc = rhs.m_priorFunc;
+    m_heapType = rhs.m_heapType;
+    m_structure = rhs.m_structure;
+    m_hasKeyRange = rhs.m_hasKeyRange;
+    m_minKey = rhs.m_minKey;
+    m_maxKey = rhs.m_maxKey;
+    m_arity = rhs.m_arity;
+    m_maxDeadFraction = rhs.m_maxDeadFraction;
+    m_lazyMerge = rhs.m_lazyMerge;
+    m_latency = rhs.m_latency;
+    m_heap = rhs.m_heap;
+    m_size = rhs.m_size;
+    m_numDead = rhs.m_numDead;
+    m_arrivals = rhs.m_arrivals;
+    m_pool.swap(rhs.m_pool);
+    m_dary.swap(rhs.m_dary);
+    m_pending.swap(rhs.m_pending);
+    m_bucketHead.swap(rhs.m_bucketHead);
+    m_bucketTail.swap(rhs.m_bucketTail);
+    m_bucketBits.swap(rhs.m_bucketBits);
+    rhs.m_heap = nullptr;
+    rhs.m_size = 0;
+    rhs.m_numDead = 0;
+    rhs.m_pending.clear();
+    rhs.m_dary.clear();
+    rhs.resetBuckets();
+}
+
+// copyHeap(Node* node)
+// Helper function of PQueue(const PQueue& rhs) and operator=(const PQueue& rhs)
+// that performs an exact same copy of rhs, using an explicit stack of (original, copy) pairs
+Node* PQueue::copyHeap(Node* node) {
     if (!node) {
         return nullptr;
     }
     
-    Node* newNode = new Node (node -> m_patient);
-    newNode -> m_left = copyRecursively(node -> m_left);
-    newNode -> m_right = copyRecursively(node -> m_right);
+    Node* newRoot = copyNode(node);
+    vector<pair<Node*, Node*> > stack;
+    stack.push_back(make_pair(node, newRoot));
+    
+    while (!stack.empty()) {
+        Node* original = stack.back().first;
+        Node* copy = stack.back().second;
+        stack.pop_back();
+        
+        if (original -> m_left) {
+            copy -> m_left = copyNode(original -> m_left);
+            copy -> m_left -> m_parent = copy;
+            stack.push_back(make_pair(original -> m_left, copy -> m_left));
+        }
+        if (original -> m_right) {
+            copy -> m_right = copyNode(original -> m_right);
+            copy -> m_right -> m_parent = copy;
+            stack.push_back(make_pair(original -> m_right, copy -> m_right));
+        }
+    }
     
+    return newRoot;
+}
+
+// copyNode(Node* node)
+// Helper function of copyHeap(Node* node) that copies a single node without its children
+Node* PQueue::copyNode(Node* node) {
+    Node* newNode = m_pool.allocate(node -> m_patient);
+    PQUEUE_COUNT(m_counters.m_allocations);
+    newNode -> m_npl = node -> m_npl;
+    newNode -> m_key = node -> m_key;
+    newNode -> m_dead = node -> m_dead;
     return newNode;
 }
 
 // mergeWithQueue(PQueue& rhs)
 // Merge the queue with the another
 void PQueue::mergeWithQueue(PQueue& rhs) {
+    LatencyTimer timer(m_latency, MERGELATENCY);
     
     // Check if queues have the same priority functions and data structures
     if (this != &rhs && m_priorFunc == rhs.m_priorFunc && m_structure == rhs.m_structure) {
-        m_heap = merge(m_heap, rhs.m_heap);
+        bool isTree = (m_structure == SKEW || m_structure == LEFTIST || m_structure == PAIRING);
+        if (m_lazyMerge && isTree) {
+            // Only the roots are handed over, the melding waits for the next dequeue
+            if (rhs.m_heap) {
+                m_pending.push_back(rhs.m_heap);
+            }
+            m_pending.insert(m_pending.end(), rhs.m_pending.begin(), rhs.m_pending.end());
+            rhs.m_pending.clear();
+            
+        } else if (m_structure != BUCKET || (m_minKey == rhs.m_minKey && m_maxKey == rhs.m_maxKey)) {
+            rhs.consolidatePending();
+            m_heap = merge(m_heap, rhs.m_heap);
+        }
+        
+        if (m_structure == BUCKET && m_minKey == rhs.m_minKey && m_maxKey == rhs.m_maxKey) {
+            // Same buckets on both sides, append each list of rhs to the matching list
+            for (size_t bucket = 0; bucket < m_bucketHead.size(); bucket++) {
+                if (rhs.m_bucketHead[bucket]) {
+                    rhs.m_bucketHead[bucket] -> m_parent = m_bucketTail[bucket];
+                    if (m_bucketTail[bucket]) {
+                        m_bucketTail[bucket] -> m_left = rhs.m_bucketHead[bucket];
+                    } else {
+                        m_bucketHead[bucket] = rhs.m_bucketHead[bucket];
+                    }
+                    m_bucketTail[bucket] = rhs.m_bucketTail[bucket];
+                }
+            }
+            for (size_t word = 0; word < m_bucketBits.size(); word++) {
+                m_bucketBits[word] |= rhs.m_bucketBits[word];
+            }
+            
+        } else if (m_structure == BUCKET) {
+            // Different key ranges, every patient of rhs is placed again so that each
+            // key in this range lands in its bucket and only the others overflow
+            vector<Node*> nodes;
+            rhs.detachAll(nodes);
+            stable_sort(nodes.begin(), nodes.end(), [&rhs](Node* a, Node* b) { return rhs.arrivalOf(a) < rhs.arrivalOf(b); });
+            for (Node* node : nodes) {
+                pushNode(node);
+            }
+            
+        } else if (m_structure == DARY) {
+            // Append the array of rhs and heapify the whole array bottom-up in O(n)
+            m_dary.insert(m_dary.end(), rhs.m_dary.begin(), rhs.m_dary.end());
+            rhs.m_dary.clear();
+            heapifyDary();
+        }
+        
+        m_pool.absorb(rhs.m_pool);
+        rhs.resetBuckets();
         rhs.m_heap = nullptr;
         m_size += rhs.m_size;
         rhs.m_size = 0;
+        m_numDead += rhs.m_numDead;
+        rhs.m_numDead = 0;
+        
+        // Both queues numbered their arrivals from 0, equal numbers keep no order between them
+        m_arrivals = max(m_arrivals, rhs.m_arrivals);
+        rhs.m_arrivals = 0;
     
     // Self-merging isn't possible
     } else if (this == &rhs && m_priorFunc == rhs.m_priorFunc && m_structure == rhs.m_structure) {
@@ -113,218 +360,1649 @@ void PQueue::mergeWithQueue(PQueue& rhs) {
     
 }
 
+// runParallel(int count, int numThreads, const function<void(int)>& task)
+// Run task(0) to task(count - 1) on up to numThreads threads, each thread takes the
+// next index until none are left
+static void runParallel(int count, int numThreads, const function<void(int)>& task) {
+    numThreads = min(numThreads, count);
+    if (numThreads <= 1) {
+        for (int i = 0; i < count; i++) {
+            task(i);
+        }
+        return;
+    }
+    atomic<int> next(0);
+    auto worker = [&]() {
+        for (int i = next++; i < count; i = next++) {
+            task(i);
+        }
+    };
+    vector<thread> threads;
+    for (int i = 1; i < numThreads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (thread& t : threads) {
+        t.join();
+    }
+}
+
+// mergeAll(const vector<PQueue*>& queues, int numThreads)
+// Merge many queues at once. Every round merges disjoint pairs, so the pairs of a round run
+// in parallel and each heap takes part in only log2(k) merges instead of k chained ones
+void PQueue::mergeAll(const vector<PQueue*>& queues, int numThreads) {
+    
+    // Everything is checked up front, the worker threads never throw
+    vector<PQueue*> sorted(queues);
+    sorted.push_back(this);
+    sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < sorted.size(); i++) {
+        if (!sorted[i]) {
+            throw domain_error("Cannot merge a null queue.");
+        }
+        if (i > 0 && sorted[i] == sorted[i - 1]) {
+            throw domain_error("Cannot merge queue with itself.");
+        }
+        if (sorted[i] -> m_priorFunc != m_priorFunc) {
+            throw domain_error("Queues have different priority functions or data structures.");
+        }
+    }
+    if (queues.empty()) {
+        return;
+    }
+    if (numThreads <= 0) {
+        numThreads = max(1, (int) thread::hardware_concurrency());
+    }
+    
+    // Queues of another structure take this one, a bucket queue also takes its key range
+    vector<PQueue*> mismatched;
+    for (PQueue* queue : queues) {
+        if (queue -> m_structure != m_structure) {
+            mismatched.push_back(queue);
+        }
+    }
+    runParallel(mismatched.size(), numThreads, [&](int i) {
+        if (m_structure == BUCKET) {
+            mismatched[i] -> setKeyRange(m_minKey, m_maxKey);
+        } else {
+            mismatched[i] -> setStructure(m_structure);
+        }
+    });
+    
+    // Tournament rounds, the winner of each pair is the left queue. A tree meld costs
+    // O(log n) and is over before a thread starts, so only the linear merges of the
+    // d-ary and bucket structures are worth threads, and only for large rounds
+    bool linearMerge = (m_structure == DARY || m_structure == BUCKET);
+    vector<PQueue*> round(queues);
+    while (round.size() > 1) {
+        int pairs = round.size() / 2;
+        long long roundSize = 0;
+        for (PQueue* queue : round) {
+            roundSize += queue -> m_size + queue -> m_numDead;
+        }
+        int roundThreads = (linearMerge && roundSize >= PARALLELMERGE) ? numThreads : 1;
+        runParallel(pairs, roundThreads, [&](int i) {
+            round[2 * i] -> mergeWithQueue(*round[2 * i + 1]);
+        });
+        vector<PQueue*> winners;
+        for (size_t i = 0; i < round.size(); i += 2) {
+            winners.push_back(round[i]);
+        }
+        round.swap(winners);
+    }
+    mergeWithQueue(*round[0]);
+}
+
 // merge(Node* a, Node* b)
-// Recursive helper function of mergeWithQueue(PQueue& rhs), insertPatient(const Patient& patient), reinsertNodes(Node* node), and getNextPatient() to merge two queues with the same priority  functions and data structures
+// Helper function of mergeWithQueue(PQueue& rhs), insertPatient(const Patient& patient), buildHeap(vector<Node*>& heaps), and getNextPatient() to merge two queues with the same priority  functions and data structures
+// The right spines are merged top-down in a loop, then the merge path is fixed up bottom-up,
+// so a long right spine of a skew heap cannot overflow the call stack
 Node* PQueue::merge(Node* a, Node* b) {
+    PQUEUE_COUNT(m_counters.m_merges);
     
     // Check if one of the queues is empty
-    if (!a) return b;
-    if (!b) return a;
+    if (!a || !b) {
+        Node* root = a ? a : b;
+        if (root) {
+            root -> m_parent = nullptr;
+        }
+        return root;
+    }
     
-    // Check the heap type
-    if (m_heapType == MAXHEAP) {
-        if (m_priorFunc(a -> m_patient) < m_priorFunc(b -> m_patient)) {
-            swap(a, b);
+    // Pairing heaps are linked in O(1)
+    if (m_structure == PAIRING) {
+        Node* root = meld(a, b);
+        root -> m_parent = nullptr;
+        return root;
+    }
+    
+    // Now 'a' is guaranteed to have higher priority (or is equal) than 'b'
+    if (isHigher(b, a)) {
+        swap(a, b);
+    }
+    Node* root = a;
+    
+    // First pass: walk down the right spines, the higher priority node always
+    // becomes the right child of the last node on the merge path
+    m_path.clear();
+    m_path.push_back(a);
+    while (a -> m_right) {
+        Node* next = a -> m_right;
+        if (isHigher(b, next)) {
+            swap(next, b);
         }
+        a -> m_right = next;
+        a = next;
+        m_path.push_back(a);
+    }
+    a -> m_right = b;
+    
+    // Second pass: restore the heap structure from the bottom of the merge path
+    for (int i = (int) m_path.size() - 1; i >= 0; i--) {
+        Node* node = m_path[i];
         
-    } else {
-        if (m_priorFunc(a -> m_patient) > m_priorFunc(b -> m_patient)) {
-            swap(a, b);
+        if (m_structure != LEFTIST) {
+            // Swap the children of every node on the merge path
+            swap(node -> m_left, node -> m_right);
+            PQUEUE_COUNT(m_counters.m_swaps);
+            
+        } else {
+            // Ensure the leftist property (the left child has higher NPL)
+            if (getNPL(node -> m_right) > getNPL(node -> m_left)) {
+                swap(node -> m_left, node -> m_right);
+                PQUEUE_COUNT(m_counters.m_swaps);
+            }
+            
+            // Update NPL for leftist heap
+            node -> m_npl = getNPL(node -> m_right) + 1;
         }
+        
+        if (node -> m_left) node -> m_left -> m_parent = node;
+        if (node -> m_right) node -> m_right -> m_parent = node;
     }
 
-    // Now 'a' is guaranteed to have higher priority (or is equal) than 'b'
-    // Merges the right child of 'a' with 'b', and swap the children
-    if (m_structure == SKEW) {
-        a -> m_right = merge(a -> m_right, b);
-        swap(a -> m_left, a -> m_right);
-        
-    } else {
-        
-        // Leftist heap merging strategy remains the same as before
-        a -> m_right = merge(a -> m_right, b);
+    root -> m_parent = nullptr;
+    return root;
+}
+
+// meld(Node* a, Node* b)
+// Helper function of merge(Node* a, Node* b) that links two pairing heaps in O(1)
+// The root of lower priority becomes the first child of the other root
+Node* PQueue::meld(Node* a, Node* b) {
+    if (!a) return b;
+    if (!b) return a;
+    PQUEUE_COUNT(m_counters.m_merges);
+    
+    if (isHigher(b, a)) {
+        swap(a, b);
+    }
+    if (a -> m_left) {
+        a -> m_left -> m_parent = b;
+    }
+    b -> m_right = a -> m_left;
+    b -> m_parent = a;
+    a -> m_left = b;
+    return a;
+}
+
+// pairChildren(Node* first)
+// Helper function of popNode() that combines the children of a removed pairing heap root
+// with the two-pass pairing: meld the siblings in pairs from left to right, then meld
+// the pairs from right to left into a single heap
+Node* PQueue::pairChildren(Node* first) {
+    m_path.clear();
+    while (first) {
+        Node* a = first;
+        Node* b = a -> m_right;
+        first = b ? b -> m_right : nullptr;
         
-        // Ensure the leftist property (the left child has higher NPL)
-        if (getNPL(a -> m_right) > getNPL(a -> m_left)) {
-            swap(a -> m_left, a -> m_right);
+        a -> m_right = nullptr;
+        if (b) {
+            b -> m_right = nullptr;
         }
-        
-        // Update NPL for leftist heap
-        a -> m_npl = getNPL(a -> m_right) + 1;
+        m_path.push_back(meld(a, b));
+    }
+    
+    Node* root = nullptr;
+    for (int i = (int) m_path.size() - 1; i >= 0; i--) {
+        root = meld(m_path[i], root);
+    }
+    if (root) {
+        root -> m_parent = nullptr;
     }
+    return root;
+}
 
-    return a;
+// isHigher(Node* a, Node* b) const
+// Helper function of merge(Node* a, Node* b) that checks 'a' has strictly higher priority than 'b'
+// The keys are packed, so ties are broken by arrival in the same comparison
+bool PQueue::isHigher(Node* a, Node* b) const {
+    PQUEUE_COUNT(m_counters.m_comparisons);
+    if (m_heapType == MAXHEAP) {
+        return a -> m_key > b -> m_key;
+    }
+    return a -> m_key < b -> m_key;
 }
 
 // insertPatient(const Patient& patient)
 // Insert a patient into the queue
-void PQueue::insertPatient(const Patient& patient) {
-    
-    Node * newNode = new Node (patient);
-    m_heap = merge(m_heap, newNode);
-    m_size++;
-    
-    if (m_structure == LEFTIST) {
-        m_heap -> m_npl = getNPL(m_heap);
-    }
+PatientHandle PQueue::insertPatient(const Patient& patient) {
+    LatencyTimer timer(m_latency, INSERTLATENCY);
+    PQUEUE_COUNT(m_counters.m_allocations);
+    return insertNode(m_pool.allocate(patient));
 }
 
-// getNPL(Node* node) const
-// Recursive helper function of insertPatient(const Patient& patient) to update the NPL of each nodes
-int PQueue::getNPL(Node* node) const {
-    if (!node) return -1;
-    if (!node -> m_right) return 0;
-    return node -> m_right -> m_npl + 1;
+// insertPatient(Patient&& patient)
+// Insert a patient into the queue, moving it into the node instead of copying it
+PatientHandle PQueue::insertPatient(Patient&& patient) {
+    LatencyTimer timer(m_latency, INSERTLATENCY);
+    PQUEUE_COUNT(m_counters.m_allocations);
+    return insertNode(m_pool.allocate(move(patient)));
 }
 
-// setPriorityFn(prifn_t priFn, HEAPTYPE heapType)
-// Sets the new priority function and its corresponding heap type and rebuild the heap
-void PQueue::setPriorityFn(prifn_t priFn, HEAPTYPE heapType) {
+// isHigherKey(unsigned long long a, unsigned long long b) const
+// Helper function of the d-ary heap that checks key 'a' has strictly higher priority than key 'b'
+bool PQueue::isHigherKey(unsigned long long a, unsigned long long b) const {
+    PQUEUE_COUNT(m_counters.m_comparisons);
+    return (m_heapType == MAXHEAP) ? a > b : a < b;
+}
 
-    m_priorFunc = priFn;
-    m_heapType = heapType;
-    
-    if (m_structure == SKEW) {
-        rebuildAsSkewHeap();
-        
-    } else if (m_structure == LEFTIST) {
-        rebuildAsLeftistHeap();
+// packKey(int priority, unsigned int arrival) const
+// Pack a priority and an arrival number into a key, a max-heap inverts the arrival so
+// the earlier of two equal priorities still has the higher key
+unsigned long long PQueue::packKey(int priority, unsigned int arrival) const {
+    return ((unsigned long long) ((unsigned int) priority ^ KEYSIGN) << 32) | (arrival ^ tieMask(m_heapType));
+}
+
+// arrivalOf(const Node* node) const
+// Return the arrival number packed in the key of a node
+unsigned int PQueue::arrivalOf(const Node* node) const {
+    return (unsigned int) node -> m_key ^ tieMask(m_heapType);
+}
+
+// tieMask(HEAPTYPE heapType)
+// Return the bits that invert the arrival half of the keys of a heap type
+unsigned int PQueue::tieMask(HEAPTYPE heapType) {
+    return (heapType == MAXHEAP) ? 0xFFFFFFFFu : 0;
+}
+
+// nextArrivals(int count)
+// Take count arrival numbers and return the first. When they would wrap, the queue is
+// numbered again from 0 first
+unsigned int PQueue::nextArrivals(int count) {
+    if ((unsigned long long) m_arrivals + count > 0xFFFFFFFFu) {
+        renumberArrivals();
     }
+    unsigned int first = m_arrivals;
+    m_arrivals += count;
+    return first;
 }
 
-// setStructure(STRUCTURE structure)
-// Sets the data structure of the heap and rebuild the heap
-void PQueue::setStructure(STRUCTURE structure) {
+// renumberArrivals()
+// Number the patients from 0 in the order of their arrival numbers. Equal priorities keep
+// their order, the heap is rebuilt since the keys change
+void PQueue::renumberArrivals() {
+    vector<Node*> nodes;
+    nodes.reserve(m_size + m_numDead);
+    detachAll(nodes);
+    stable_sort(nodes.begin(), nodes.end(), [this](Node* a, Node* b) { return arrivalOf(a) < arrivalOf(b); });
+    for (size_t i = 0; i < nodes.size(); i++) {
+        nodes[i] -> m_key = packKey(nodes[i] -> getKey(), (unsigned int) i);
+    }
+    m_arrivals = (unsigned int) nodes.size();
+    resetBuckets();
+    buildFrom(nodes);
+    m_size = (int) nodes.size();
+}
 
-    m_structure = structure;
+// insertNode(Node* newNode)
+// Helper function of insertPatient and emplacePatient that merges a new node into the heap
+// and returns the handle of the new patient
+PatientHandle PQueue::insertNode(Node* newNode) {
     
-    if (m_structure == SKEW) {
-        rebuildAsSkewHeap();
-        
-    } else if (m_structure == LEFTIST) {
-        rebuildAsLeftistHeap();
-    }
+    int priority = m_priorFunc(newNode -> m_patient);
+    PQUEUE_COUNT(m_counters.m_priorityCalls);
+    newNode -> m_key = packKey(priority, nextArrivals(1));
+    pushNode(newNode);
+    m_size++;
+    
+    PatientHandle handle;
+    handle.m_node = newNode;
+    handle.m_stamp = newNode -> m_stamp;
+    return handle;
 }
 
-// rebuildAsSkewHeap()
-// Rebuild the heap with skew heap property
-void PQueue::rebuildAsSkewHeap() {
+// updatePatient(const PatientHandle& handle, const Patient& patient)
+// Replace the patient of a handle and move the node to the place of its new priority
+void PQueue::updatePatient(const PatientHandle& handle, const Patient& patient) {
+    Node* node = checkHandle(handle);
+    int priority = m_priorFunc(patient);
+    PQUEUE_COUNT(m_counters.m_priorityCalls);
+    consolidatePending();
     
-    // Copy the original heap
-    Node* copiedHeap = copyRecursively(m_heap);
-    clear();
+    // The patient keeps its place in line among equal priorities, so an unchanged
+    // priority leaves the node where it is
+    unsigned long long key = packKey(priority, arrivalOf(node));
+    if (key == node -> m_key) {
+        node -> m_patient = patient;
+        return;
+    }
+    
+    // A d-ary heap entry sifts up or down from where it is
+    if (m_structure == DARY) {
+        node -> m_patient = patient;
+        node -> m_key = key;
+        m_dary[node -> m_npl].key = key;
+        siftUp(node -> m_npl);
+        siftDown(node -> m_npl);
+        return;
+    }
+    
+    // When the priority doesn't drop, the subtree of the node is still a heap, so it
+    // is cut out and merged with the root; a bucket queue only does it in the overflow heap
+    bool inRange = (priority >= m_minKey && priority <= m_maxKey) ||
+                   (node -> getKey() >= m_minKey && node -> getKey() <= m_maxKey);
+    if (!isHigherKey(node -> m_key, key) && (m_structure != BUCKET || !inRange)) {
+        node -> m_patient = patient;
+        node -> m_key = key;
+        if (node != m_heap) {
+            cutSubtree(node);
+            m_heap = merge(m_heap, node);
+        }
+        return;
+    }
     
-    // Set the structure to SKEW
-    m_structure = SKEW;
+    removeNode(node);
+    node -> m_patient = patient;
+    node -> m_key = key;
+    if (m_structure == BUCKET && priority >= m_minKey && priority <= m_maxKey) {
+        insertBucket(node);
+    } else {
+        pushNode(node);
+    }
+}
+
+// removePatient(const PatientHandle& handle)
+// Remove and return the patient of a handle
+Patient PQueue::removePatient(const PatientHandle& handle) {
+    Node* node = checkHandle(handle);
+    consolidatePending();
+    removeNode(node);
+    Patient patient = move(node -> m_patient);
+    m_pool.deallocate(node);
+    m_size--;
+    return patient;
+}
 
-    // Reinsert nodes into the new skew heap
-    reinsertNodes(copiedHeap);
+// contains(const PatientHandle& handle) const
+// Check the node of the handle is one of this queue and still holds the patient it was
+// created for; after a merge the node belongs to the queue that absorbed its slab
+bool PQueue::contains(const PatientHandle& handle) const {
+    return handle.m_node && m_pool.owns(handle.m_node) &&
+           handle.m_node -> m_stamp == handle.m_stamp;
 }
 
-// rebuildAsLeftistHeap()
-// Rebuild the heap with leftist heap property
-void PQueue::rebuildAsLeftistHeap() {
+// cancelPatient(const PatientHandle& handle)
+// Mark the patient of a handle as cancelled; the node is freed lazily when it reaches the
+// top, or by a compaction once there are too many tombstones
+void PQueue::cancelPatient(const PatientHandle& handle) {
+    Node* node = checkHandle(handle);
+    node -> m_dead = true;
+    node -> m_stamp++;
+    m_size--;
+    m_numDead++;
     
-    // Copy the original heap
-    Node* copiedHeap = copyRecursively(m_heap);
-    clear();
+    if (m_numDead > m_maxDeadFraction * m_size) {
+        compact();
+    }
+}
+
+// compact()
+// Free every tombstone, the live nodes are rebuilt in place in linear time
+void PQueue::compact() {
+    if (m_numDead > 0) {
+        rebuildHeap(false);
+    }
+}
+
+// setMaxDeadFraction(double fraction)
+// Sets how many tombstones per live patient the queue keeps before it compacts itself
+void PQueue::setMaxDeadFraction(double fraction) {
+    if (fraction < 0) {
+        throw domain_error("The fraction of cancelled patients can't be negative.");
+    }
     
-    // Set the structure to LEFTIST
-    m_structure = LEFTIST;
+    m_maxDeadFraction = fraction;
+    if (m_numDead > m_maxDeadFraction * m_size) {
+        compact();
+    }
+}
 
-    // Reinsert nodes into the new leftist heap
-    reinsertNodes(copiedHeap);
+// getMaxDeadFraction() const
+// Return the fraction of tombstones that triggers a compaction
+double PQueue::getMaxDeadFraction() const {
+    return m_maxDeadFraction;
 }
 
-// reinsertNodes(Node* node)
-// Recursive helper function of rebuildAsSkewHeap() and rebuildAsLeftistHeap() to rebuild the heap with the new data structure
-void PQueue::reinsertNodes(Node* node) {
-    if (node == nullptr) {
-        return;
+// numDead() const
+// Return the number of cancelled patients whose nodes are not freed yet
+int PQueue::numDead() const {
+    return m_numDead;
+}
+
+// setLazyMerge(bool lazy)
+// Turn the lazy merge mode on or off, the pending heaps are melded when it is turned off
+void PQueue::setLazyMerge(bool lazy) {
+    m_lazyMerge = lazy;
+    if (!lazy) {
+        consolidatePending();
     }
+}
 
-    Node* left = node->m_left;
-    Node* right = node->m_right;
+// getLazyMerge() const
+// Return true when mergeWithQueue defers the melding
+bool PQueue::getLazyMerge() const {
+    return m_lazyMerge;
+}
 
-    // Detach the children to prevent them from being deleted
-    node->m_left = nullptr;
-    node->m_right = nullptr;
+// setLatencyRecorder(LatencyRecorder* recorder)
+// Start recording the operation latencies in recorder, or stop when it is null
+void PQueue::setLatencyRecorder(LatencyRecorder* recorder) {
+    m_latency = recorder;
+}
 
-    // Merge the current node into the skew heap
-    m_heap = merge(m_heap, node);
-    m_size++;
+// getLatencyRecorder() const
+// Return the recorder of the operation latencies, null when they are not recorded
+LatencyRecorder* PQueue::getLatencyRecorder() const {
+    return m_latency;
+}
 
-    // Recursively reinsert left and right children
-    reinsertNodes(left);
-    reinsertNodes(right);
+// consolidatePending()
+// Meld the heaps of the lazy merges with the main heap in one balanced pairwise pass,
+// so k pending heaps cost O(k) merges instead of k merges into a growing heap
+void PQueue::consolidatePending() {
+    if (m_pending.empty()) {
+        return;
+    }
+    if (m_heap) {
+        m_pending.push_back(m_heap);
+    }
+    m_heap = buildHeap(m_pending);
+    m_pending.clear();
 }
 
-// printPatientQueue() const
-// Print the list of the queue based on priority number using preorder traversal
-void PQueue::printPatientQueue() const {
-    printPreorder(m_heap);
+// freeDead(Node* node)
+// Return the node of a cancelled patient to the pool once it is out of the data structure
+void PQueue::freeDead(Node* node) {
+    m_pool.deallocate(node);
+    m_numDead--;
 }
 
-// printPreorder(Node* node) const
-// Recursive helper function of printPatientQueue() const to print each patient's information by traversing the heap
-void PQueue::printPreorder(Node* node) const {
-    if (node != nullptr) {
-        cout << "[" << m_priorFunc(node -> m_patient) << "] " << node -> m_patient << endl;
-        printPreorder(node -> m_left);
-        printPreorder(node -> m_right);
+// checkHandle(const PatientHandle& handle) const
+// Helper function of updatePatient and removePatient that returns the node of a valid handle
+Node* PQueue::checkHandle(const PatientHandle& handle) const {
+    if (!contains(handle)) {
+        throw domain_error("The patient of the handle is no longer in the queue.");
     }
+    return handle.m_node;
 }
 
-// getNextPatient()
-// Remove and return the highest priority patient from the queue
-Patient PQueue::getNextPatient() {
+// removeNode(Node* node)
+// Helper function of updatePatient and removePatient that takes a single node out of the
+// data structure wherever it is; its children, if any, stay in the queue
+void PQueue::removeNode(Node* node) {
+    if (m_structure == DARY) {
+        // The last entry fills the hole and moves up or down
+        int index = node -> m_npl;
+        DaryEntry last = m_dary.back();
+        m_dary.pop_back();
+        if (index < (int) m_dary.size()) {
+            m_dary[index] = last;
+            last.node -> m_npl = index;
+            siftUp(index);
+            siftDown(last.node -> m_npl);
+        }
+        node -> m_npl = 0;
+        return;
+    }
     
-    // Flag when the queue is empty and call this function
-    if (!m_heap) {
-        throw out_of_range("The queue is empty.");
+    if (m_structure == BUCKET && node -> getKey() >= m_minKey && node -> getKey() <= m_maxKey) {
+        unlinkBucket(node);
+        return;
     }
     
-    // Traverse the queue, remove the highest priority patient, and adjust the queue
-    Node* root = m_heap;
-    Patient patient = root -> m_patient;
-    m_heap = merge(root -> m_left, root -> m_right);
-    delete root;
-    m_size--;
-    return patient;
+    // Cut the node out of its tree, then its children are merged back with the root
+    cutSubtree(node);
+    Node* children;
+    if (m_structure == PAIRING) {
+        children = pairChildren(node -> m_left);
+    } else {
+        children = merge(node -> m_left, node -> m_right);
+    }
+    node -> m_left = nullptr;
+    node -> m_right = nullptr;
+    node -> m_npl = 0;
+    m_heap = merge(m_heap, children);
 }
 
-// getPriorityFn() const
-// Return the current priority function
-prifn_t PQueue::getPriorityFn() const {
-    return m_priorFunc;
+// cutSubtree(Node* node)
+// Helper function of removeNode(Node* node) and updatePatient that detaches a node and its
+// subtree from its parent; the NPL values of a leftist heap are fixed on the way up
+void PQueue::cutSubtree(Node* node) {
+    Node* parent = node -> m_parent;
+    node -> m_parent = nullptr;
+    if (!parent) {
+        m_heap = nullptr;
+        return;
+    }
+    
+    if (m_structure == PAIRING) {
+        // The parent link of a pairing heap node is the previous sibling, except for the first child
+        if (parent -> m_left == node) {
+            parent -> m_left = node -> m_right;
+        } else {
+            parent -> m_right = node -> m_right;
+        }
+        if (node -> m_right) {
+            node -> m_right -> m_parent = parent;
+        }
+        node -> m_right = nullptr;
+        return;
+    }
+    
+    if (parent -> m_left == node) {
+        parent -> m_left = nullptr;
+    } else {
+        parent -> m_right = nullptr;
+    }
+    if (m_structure == LEFTIST) {
+        fixNPL(parent);
+    }
 }
 
-// numPatients() const
-// Return the current number of patients in the queue
-int PQueue::numPatients() const {
-    return m_size;
+// fixNPL(Node* node)
+// Helper function of cutSubtree(Node* node) that restores the leftist property from node up
+// to the root, it stops at the first node whose NPL doesn't change
+void PQueue::fixNPL(Node* node) {
+    while (node) {
+        if (getNPL(node -> m_right) > getNPL(node -> m_left)) {
+            swap(node -> m_left, node -> m_right);
+            PQUEUE_COUNT(m_counters.m_swaps);
+        }
+        
+        int npl = getNPL(node -> m_right) + 1;
+        if (npl == node -> m_npl) {
+            break;
+        }
+        node -> m_npl = npl;
+        node = node -> m_parent;
+    }
 }
 
-// getHeapType() const
-// Return the current type of the heap
-HEAPTYPE PQueue::getHeapType() const {
-    return m_heapType;
+// unlinkBucket(Node* node)
+// Helper function of removeNode(Node* node) that takes a node out of the middle of its bucket
+void PQueue::unlinkBucket(Node* node) {
+    int bucket = node -> getKey() - m_minKey;
+    Node* previous = node -> m_parent;
+    Node* next = node -> m_left;
+    
+    if (previous) {
+        previous -> m_left = next;
+    } else {
+        m_bucketHead[bucket] = next;
+    }
+    if (next) {
+        next -> m_parent = previous;
+    } else {
+        m_bucketTail[bucket] = previous;
+    }
+    if (!m_bucketHead[bucket]) {
+        m_bucketBits[bucket / 64] &= ~(1ULL << (bucket % 64));
+    }
+    node -> m_left = nullptr;
+    node -> m_parent = nullptr;
 }
 
-// getRoot() const
-// Helper function to get the root node of the queue
-Node* PQueue::getRoot() const {
-    return m_heap;
+// insertNodes(vector<Node*>& nodes)
+// Helper function of insertPatients(Iterator first, Iterator last) that heapifies the new
+// single node heaps pairwise together with the current heap
+void PQueue::insertNodes(vector<Node*>& nodes) {
+    m_size += (int) nodes.size();
+    if (m_structure == BUCKET) {
+        for (Node* node : nodes) {
+            pushNode(node);
+        }
+        return;
+    }
+    if (m_structure == DARY) {
+        for (Node* node : nodes) {
+            m_dary.push_back({node -> m_key, node});
+        }
+        heapifyDary();
+        return;
+    }
+    
+    if (m_heap) {
+        nodes.push_back(m_heap);
+    }
+    m_heap = buildHeap(nodes);
+}
+
+// topNode() const
+// Return the node of the highest priority patient, nullptr if the queue is empty
+Node* PQueue::topNode() const {
+    if (m_structure == DARY) {
+        return m_dary.empty() ? nullptr : m_dary[0].node;
+    }
+    if (m_structure != BUCKET) {
+        // The roots of the lazily merged heaps compete with the main root
+        Node* top = m_heap;
+        for (Node* pending : m_pending) {
+            if (!top || isHigher(pending, top)) {
+                top = pending;
+            }
+        }
+        return top;
+    }
+    
+    // The best bucket competes with the root of the overflow heap
+    int bucket = firstBucket();
+    if (bucket < 0) {
+        return m_heap;
+    }
+    Node* node = m_bucketHead[bucket];
+    if (m_heap && isHigher(m_heap, node)) {
+        return m_heap;
+    }
+    return node;
+}
+
+// pushNode(Node* node)
+// Add a single node whose key is already cached to the data structure
+void PQueue::pushNode(Node* node) {
+    if (m_structure == BUCKET && node -> getKey() >= m_minKey && node -> getKey() <= m_maxKey) {
+        pushBucket(node);
+    } else if (m_structure == DARY) {
+        m_dary.push_back({node -> m_key, node});
+        siftUp((int) m_dary.size() - 1);
+    } else {
+        m_heap = merge(m_heap, node);
+    }
+}
+
+// popNode()
+// Remove the node of the highest priority patient from the data structure
+Node* PQueue::popNode() {
+    consolidatePending();
+    if (m_structure == DARY) {
+        // The last entry fills the root and sinks to its place
+        Node* root = m_dary[0].node;
+        m_dary[0] = m_dary.back();
+        m_dary.pop_back();
+        if (!m_dary.empty()) {
+            siftDown(0);
+        }
+        root -> m_npl = 0;
+        return root;
+    }
+    
+    Node* node = topNode();
+    if (m_structure == PAIRING) {
+        m_heap = pairChildren(node -> m_left);
+    } else if (node == m_heap) {
+        m_heap = merge(node -> m_left, node -> m_right);
+    } else {
+        popBucket(node -> getKey() - m_minKey);
+    }
+    node -> m_left = nullptr;
+    node -> m_right = nullptr;
+    return node;
+}
+
+// detachAll(vector<Node*>& nodes)
+// Collect every live node of the queue as a single node heap, leaving the data structure empty
+void PQueue::detachAll(vector<Node*>& nodes) {
+    detachNodes(m_heap, nodes);
+    for (Node* pending : m_pending) {
+        detachNodes(pending, nodes);
+    }
+    m_pending.clear();
+    for (size_t bucket = 0; bucket < m_bucketHead.size(); bucket++) {
+        detachNodes(m_bucketHead[bucket], nodes);
+    }
+    for (const DaryEntry& entry : m_dary) {
+        entry.node -> m_npl = 0;
+        nodes.push_back(entry.node);
+    }
+    m_heap = nullptr;
+    m_dary.clear();
+    resetBuckets();
+    
+    // Tombstones are freed instead of being rebuilt
+    if (m_numDead > 0) {
+        size_t live = 0;
+        for (Node* node : nodes) {
+            if (node -> m_dead) {
+                freeDead(node);
+            } else {
+                nodes[live++] = node;
+            }
+        }
+        nodes.resize(live);
+    }
+}
+
+// buildFrom(vector<Node*>& nodes)
+// Build the data structure from single node heaps in O(n)
+void PQueue::buildFrom(vector<Node*>& nodes) {
+    LatencyTimer timer(m_latency, REBUILDLATENCY);
+    PQUEUE_COUNT(m_counters.m_rebuilds);
+    if (m_structure == BUCKET) {
+        // The nodes come in tree or bucket order, a bucket must be filled in arrival order
+        stable_sort(nodes.begin(), nodes.end(), [this](Node* a, Node* b) { return arrivalOf(a) < arrivalOf(b); });
+        for (Node* node : nodes) {
+            pushNode(node);
+        }
+    } else if (m_structure == DARY) {
+        m_dary.reserve(nodes.size());
+        for (Node* node : nodes) {
+            m_dary.push_back({node -> m_key, node});
+        }
+        heapifyDary();
+    } else {
+        m_heap = buildHeap(nodes);
+    }
+}
+
+// siftUp(int index)
+// Move the entry at index up the d-ary heap until its parent has a higher or equal priority
+// The entry is held aside and parents are shifted down into the hole
+void PQueue::siftUp(int index) {
+    DaryEntry entry = m_dary[index];
+    while (index > 0) {
+        int parent = (index - 1) / m_arity;
+        if (!isHigherKey(entry.key, m_dary[parent].key)) {
+            break;
+        }
+        m_dary[index] = m_dary[parent];
+        m_dary[index].node -> m_npl = index;
+        index = parent;
+    }
+    m_dary[index] = entry;
+    entry.node -> m_npl = index;
+}
+
+// siftDown(int index)
+// Move the entry at index down the d-ary heap until no child has a higher priority
+void PQueue::siftDown(int index) {
+    int size = (int) m_dary.size();
+    DaryEntry entry = m_dary[index];
+    while (true) {
+        int first = index * m_arity + 1;
+        if (first >= size) {
+            break;
+        }
+        
+        // Find the child of the highest priority among the d children
+        int last = (first + m_arity < size) ? first + m_arity : size;
+        int best = first;
+        for (int child = first + 1; child < last; child++) {
+            if (isHigherKey(m_dary[child].key, m_dary[best].key)) {
+                best = child;
+            }
+        }
+        if (!isHigherKey(m_dary[best].key, entry.key)) {
+            break;
+        }
+        m_dary[index] = m_dary[best];
+        m_dary[index].node -> m_npl = index;
+        index = best;
+    }
+    m_dary[index] = entry;
+    entry.node -> m_npl = index;
+}
+
+// heapifyDary()
+// Build the d-ary heap bottom-up from an unordered array in O(n)
+void PQueue::heapifyDary() {
+    int size = (int) m_dary.size();
+    for (int index = 0; index < size; index++) {
+        m_dary[index].node -> m_npl = index;
+    }
+    for (int index = (size - 2) / m_arity; index >= 0 && size > 1; index--) {
+        siftDown(index);
+    }
+}
+
+// resetBuckets()
+// Empty every bucket, the buckets exist only in a BUCKET queue
+void PQueue::resetBuckets() {
+    int count = (m_structure == BUCKET) ? m_maxKey - m_minKey + 1 : 0;
+    m_bucketHead.assign(count, nullptr);
+    m_bucketTail.assign(count, nullptr);
+    m_bucketBits.assign((count + 63) / 64, 0);
+}
+
+// firstBucket() const
+// Return the non-empty bucket of the highest priority, -1 if every bucket is empty
+// The bitmap is scanned a word at a time with find-first-set (find-last-set for a max-heap)
+int PQueue::firstBucket() const {
+    int words = (int) m_bucketBits.size();
+    if (m_heapType == MINHEAP) {
+        for (int word = 0; word < words; word++) {
+            if (m_bucketBits[word]) {
+                return word * 64 + __builtin_ctzll(m_bucketBits[word]);
+            }
+        }
+    } else {
+        for (int word = words - 1; word >= 0; word--) {
+            if (m_bucketBits[word]) {
+                return word * 64 + 63 - __builtin_clzll(m_bucketBits[word]);
+            }
+        }
+    }
+    return -1;
+}
+
+// nextBucket(int bucket) const
+// Return the non-empty bucket that follows bucket in priority order, -1 if there is none
+int PQueue::nextBucket(int bucket) const {
+    int count = (int) m_bucketHead.size();
+    int step = (m_heapType == MINHEAP) ? 1 : -1;
+    for (bucket += step; bucket >= 0 && bucket < count; bucket += step) {
+        if (m_bucketHead[bucket]) {
+            return bucket;
+        }
+    }
+    return -1;
+}
+
+// pushBucket(Node* node)
+// Append a node whose key is in the declared range at the end of its bucket
+void PQueue::pushBucket(Node* node) {
+    int bucket = node -> getKey() - m_minKey;
+    node -> m_left = nullptr;
+    node -> m_right = nullptr;
+    node -> m_parent = m_bucketTail[bucket];
+    if (m_bucketTail[bucket]) {
+        m_bucketTail[bucket] -> m_left = node;
+    } else {
+        m_bucketHead[bucket] = node;
+        m_bucketBits[bucket / 64] |= 1ULL << (bucket % 64);
+    }
+    m_bucketTail[bucket] = node;
+}
+
+// insertBucket(Node* node)
+// Put a node whose key is in the declared range in its bucket behind every patient that
+// arrived before it. The bucket is searched from its tail, O(patients arriving later)
+void PQueue::insertBucket(Node* node) {
+    int bucket = node -> getKey() - m_minKey;
+    unsigned int arrival = arrivalOf(node);
+    Node* previous = m_bucketTail[bucket];
+    while (previous && arrivalOf(previous) > arrival) {
+        previous = previous -> m_parent;
+    }
+    if (previous == m_bucketTail[bucket]) {
+        pushBucket(node);
+        return;
+    }
+    
+    // Some patient arrived later, so the bucket isn't empty and node gets a next patient
+    Node* next = previous ? previous -> m_left : m_bucketHead[bucket];
+    node -> m_left = next;
+    node -> m_right = nullptr;
+    node -> m_parent = previous;
+    next -> m_parent = node;
+    if (previous) {
+        previous -> m_left = node;
+    } else {
+        m_bucketHead[bucket] = node;
+    }
+}
+
+// popBucket(int bucket)
+// Remove the first node of a non-empty bucket
+Node* PQueue::popBucket(int bucket) {
+    Node* node = m_bucketHead[bucket];
+    m_bucketHead[bucket] = node -> m_left;
+    if (node -> m_left) {
+        node -> m_left -> m_parent = nullptr;
+    } else {
+        m_bucketTail[bucket] = nullptr;
+        m_bucketBits[bucket / 64] &= ~(1ULL << (bucket % 64));
+    }
+    node -> m_left = nullptr;
+    return node;
+}
+
+// getNPL(Node* node) const
+// Recursive helper function of insertPatient(const Patient& patient) to update the NPL of each nodes
+int PQueue::getNPL(Node* node) const {
+    if (!node) return -1;
+    if (!node -> m_right) return 0;
+    return node -> m_right -> m_npl + 1;
+}
+
+// setPriorityFn(prifn_t priFn, HEAPTYPE heapType)
+// Sets the new priority function and its corresponding heap type and rebuild the heap
+void PQueue::setPriorityFn(prifn_t priFn, HEAPTYPE heapType) {
+
+    // The arrival halves of the keys were inverted for the old heap type
+    unsigned int flipTies = tieMask(m_heapType) ^ tieMask(heapType);
+    m_priorFunc = priFn;
+    m_heapType = heapType;
+    
+    // Every cached key is stale, refresh them while the heap is rebuilt
+    rebuildHeap(true, flipTies);
+}
+
+// setStructure(STRUCTURE structure)
+// Sets the data structure of the heap and rebuild the heap
+void PQueue::setStructure(STRUCTURE structure) {
+
+    if (structure == BUCKET && !m_hasKeyRange) {
+        throw domain_error("A key range must be declared for a bucket queue.");
+    }
+    
+    // Detach the nodes while the old structure is still known
+    vector<Node*> nodes;
+    nodes.reserve(m_size + m_numDead);
+    detachAll(nodes);
+    m_structure = structure;
+    resetBuckets();
+    buildFrom(nodes);
+}
+
+// setArity(int arity)
+// Sets the number of children per node of the d-ary heap and rebuild it when it is in use
+void PQueue::setArity(int arity) {
+    if (arity < 2) {
+        throw domain_error("A d-ary heap needs at least two children per node.");
+    }
+    
+    m_arity = arity;
+    if (m_structure == DARY) {
+        heapifyDary();
+    }
+}
+
+// getArity() const
+// Return the number of children per node of the d-ary heap
+int PQueue::getArity() const {
+    return m_arity;
+}
+
+// setKeyRange(int minKey, int maxKey)
+// Declare the range of keys of the priority function and rebuild the queue as a bucket queue
+void PQueue::setKeyRange(int minKey, int maxKey) {
+    if (minKey > maxKey || (long long) maxKey - minKey + 1 > MAXBUCKETS) {
+        throw domain_error("The key range is empty or too wide for a bucket queue.");
+    }
+    
+    vector<Node*> nodes;
+    nodes.reserve(m_size + m_numDead);
+    detachAll(nodes);
+    m_hasKeyRange = true;
+    m_minKey = minKey;
+    m_maxKey = maxKey;
+    m_structure = BUCKET;
+    resetBuckets();
+    buildFrom(nodes);
+}
+
+// rebuildHeap(bool refreshKeys, unsigned int flipTies)
+// Rebuild the heap in place with the current priority function, heap type and data structure
+// The nodes are detached without copying them and heapified again in linear time; refreshed
+// keys keep their arrival numbers, read back through flipTies when the heap type changed
+void PQueue::rebuildHeap(bool refreshKeys, unsigned int flipTies) {
+    
+    // Detach the original heap, its nodes are reused in place
+    vector<Node*> nodes;
+    nodes.reserve(m_size + m_numDead);
+    detachAll(nodes);
+    
+    if (refreshKeys) {
+        for (Node* node : nodes) {
+            node -> m_key = packKey(m_priorFunc(node -> m_patient), arrivalOf(node) ^ flipTies);
+            PQUEUE_COUNT(m_counters.m_priorityCalls);
+        }
+    }
+    
+    resetBuckets();
+    buildFrom(nodes);
+    m_size = (int) nodes.size();
+}
+
+// detachNodes(Node* node, vector<Node*>& nodes)
+// Helper function of rebuildHeap(bool refreshKeys, unsigned int flipTies) that collects every node of the heap
+// and turns each of them into a single node heap
+void PQueue::detachNodes(Node* node, vector<Node*>& nodes) {
+    size_t next = nodes.size();
+    if (node != nullptr) {
+        nodes.push_back(node);
+    }
+    
+    // The collected nodes double as the queue of nodes still to visit
+    while (next < nodes.size()) {
+        node = nodes[next++];
+        if (node -> m_left) nodes.push_back(node -> m_left);
+        if (node -> m_right) nodes.push_back(node -> m_right);
+        
+        node -> m_left = nullptr;
+        node -> m_right = nullptr;
+        node -> m_parent = nullptr;
+        node -> m_npl = 0;
+    }
+}
+
+// buildHeap(vector<Node*>& heaps)
+// Heapify a list of heaps by merging them pairwise, round after round, until one is left
+// Each round halves the number of heaps, so n single node heaps are built in O(n)
+Node* PQueue::buildHeap(vector<Node*>& heaps) {
+    size_t count = heaps.size();
+    if (count == 0) {
+        return nullptr;
+    }
+    
+    while (count > 1) {
+        size_t merged = 0;
+        for (size_t i = 0; i + 1 < count; i += 2) {
+            heaps[merged++] = merge(heaps[i], heaps[i + 1]);
+        }
+        
+        // An odd heap out waits for the next round
+        if (count % 2 == 1) {
+            heaps[merged++] = heaps[count - 1];
+        }
+        count = merged;
+    }
+    
+    heaps[0] -> m_parent = nullptr;
+    return heaps[0];
+}
+
+// printPatientQueue() const
+// Print the list of the queue based on priority number using preorder traversal
+void PQueue::printPatientQueue() const {
+    
+    // A bucket queue prints its buckets in priority order, then its overflow heap
+    for (int bucket = firstBucket(); bucket >= 0; bucket = nextBucket(bucket)) {
+        printPreorder(m_bucketHead[bucket]);
+    }
+    printPreorder(m_heap);
+    for (Node* pending : m_pending) {
+        printPreorder(pending);
+    }
+    
+    // A d-ary heap prints its array in level order
+    for (const DaryEntry& entry : m_dary) {
+        printPreorder(entry.node);
+    }
+}
+
+// printPreorder(Node* node) const
+// Helper function of printPatientQueue() const to print each patient's information by traversing the heap
+void PQueue::printPreorder(Node* node) const {
+    vector<Node*> stack;
+    if (node != nullptr) {
+        stack.push_back(node);
+    }
+    
+    while (!stack.empty()) {
+        node = stack.back();
+        stack.pop_back();
+        if (!node -> m_dead) {
+            cout << "[" << node -> getKey() << "] " << node -> m_patient << endl;
+        }
+        if (node -> m_right) stack.push_back(node -> m_right);
+        if (node -> m_left) stack.push_back(node -> m_left);
+    }
+}
+
+// getNextPatient()
+// Remove and return the highest priority patient from the queue
+Patient PQueue::getNextPatient() {
+    
+    // Flag when the queue is empty and call this function
+    if (m_size == 0) {
+        throw out_of_range("The queue is empty.");
+    }
+    LatencyTimer timer(m_latency, DEQUEUELATENCY);
+    
+    // Remove the highest priority patient, and adjust the queue
+    // Tombstones that come to the top on the way are freed
+    Node* root = popNode();
+    while (root -> m_dead) {
+        freeDead(root);
+        root = popNode();
+    }
+    Patient patient = move(root -> m_patient);
+    m_pool.deallocate(root);
+    m_size--;
+    return patient;
+}
+
+// popNodes(int k, vector<Node*>& nodes)
+// Helper function of getNextPatients(int k, OutputIterator out) that removes the nodes of the
+// k highest priority patients in priority order
+// A tree is searched with a frontier heap of the roots of the subtrees not taken yet, so
+// only O(k) nodes are visited; the frontier is then merged pairwise into the new heap
+void PQueue::popNodes(int k, vector<Node*>& nodes) {
+    if (k > m_size) {
+        k = m_size;
+    }
+    if (k <= 0) {
+        return;
+    }
+    nodes.reserve(nodes.size() + k);
+    m_size -= k;
+    size_t wanted = nodes.size() + k;
+    
+    // Buckets and d-ary heaps remove their top in O(1) and O(log n) without merging
+    if (m_structure == BUCKET || m_structure == DARY) {
+        while (nodes.size() < wanted) {
+            Node* node = popNode();
+            if (node -> m_dead) {
+                freeDead(node);
+            } else {
+                nodes.push_back(node);
+            }
+        }
+        return;
+    }
+    
+    // The frontier is a binary heap with the highest priority root at the front, the
+    // heaps of lazy merges start in it and are melded with the rest at the end
+    auto lower = [this](Node* a, Node* b) { return isHigher(b, a); };
+    vector<Node*> frontier;
+    frontier.swap(m_pending);
+    if (m_heap) {
+        frontier.push_back(m_heap);
+    }
+    make_heap(frontier.begin(), frontier.end(), lower);
+    m_heap = nullptr;
+    
+    while (nodes.size() < wanted) {
+        pop_heap(frontier.begin(), frontier.end(), lower);
+        Node* node = frontier.back();
+        frontier.pop_back();
+        
+        // The subtrees of the node join the frontier, every child of a pairing heap
+        // node is the root of its own subtree
+        if (m_structure == PAIRING) {
+            Node* child = node -> m_left;
+            while (child) {
+                Node* next = child -> m_right;
+                child -> m_right = nullptr;
+                frontier.push_back(child);
+                push_heap(frontier.begin(), frontier.end(), lower);
+                child = next;
+            }
+        } else {
+            if (node -> m_left) {
+                frontier.push_back(node -> m_left);
+                push_heap(frontier.begin(), frontier.end(), lower);
+            }
+            if (node -> m_right) {
+                frontier.push_back(node -> m_right);
+                push_heap(frontier.begin(), frontier.end(), lower);
+            }
+        }
+        node -> m_left = nullptr;
+        node -> m_right = nullptr;
+        node -> m_npl = 0;
+        if (node -> m_dead) {
+            freeDead(node);
+        } else {
+            nodes.push_back(node);
+        }
+    }
+    
+    // The subtrees left in the frontier are valid heaps
+    m_heap = buildHeap(frontier);
+}
+
+// peekTopK(int k) const
+// Return copies of the k highest priority patients in priority order without changing the queue
+vector<Patient> PQueue::peekTopK(int k) const {
+    vector<Patient> patients;
+    if (k <= 0) {
+        return patients;
+    }
+    patients.reserve(k < m_size ? k : m_size);
+    for (const_iterator it = begin(); it != end() && (int) patients.size() < k; ++it) {
+        patients.push_back(*it);
+    }
+    return patients;
+}
+
+// begin() const
+// Return an iterator to the highest priority patient
+PQueue::const_iterator PQueue::begin() const {
+    return const_iterator(this);
+}
+
+// end() const
+// Return the iterator past the lowest priority patient
+PQueue::const_iterator PQueue::end() const {
+    return const_iterator();
+}
+
+// startFrontier(vector<Node*>& frontier) const
+// Helper function of const_iterator that puts the top of every part of the queue in the frontier
+void PQueue::startFrontier(vector<Node*>& frontier) const {
+    frontier.clear();
+    if (m_structure == DARY && !m_dary.empty()) {
+        pushFrontier(frontier, m_dary[0].node);
+    }
+    
+    // A bucket queue starts with its best bucket and the root of the overflow heap
+    if (m_structure == BUCKET) {
+        int bucket = firstBucket();
+        if (bucket >= 0) {
+            pushFrontier(frontier, m_bucketHead[bucket]);
+        }
+    }
+    if (m_heap) {
+        pushFrontier(frontier, m_heap);
+    }
+    for (Node* pending : m_pending) {
+        pushFrontier(frontier, pending);
+    }
+    if (!frontier.empty() && frontier.front() -> m_dead) {
+        advanceFrontier(frontier);
+    }
+}
+
+// advanceFrontier(vector<Node*>& frontier) const
+// Helper function of const_iterator that removes the front node of the frontier and adds
+// the nodes that may come next: its children, or the next patient of its bucket
+// Tombstones are expanded the same way but never left at the front
+void PQueue::advanceFrontier(vector<Node*>& frontier) const {
+    auto lower = [this](Node* a, Node* b) { return isHigher(b, a); };
+    do {
+        pop_heap(frontier.begin(), frontier.end(), lower);
+        Node* node = frontier.back();
+        frontier.pop_back();
+        
+        if (m_structure == DARY) {
+            int size = (int) m_dary.size();
+            int first = node -> m_npl * m_arity + 1;
+            for (int child = first; child < first + m_arity && child < size; child++) {
+                pushFrontier(frontier, m_dary[child].node);
+            }
+        
+        } else if (m_structure == BUCKET && node -> getKey() >= m_minKey && node -> getKey() <= m_maxKey) {
+            // The head of a bucket also opens the next bucket, the buckets are visited one by one
+            int bucket = node -> getKey() - m_minKey;
+            if (node -> m_left) {
+                pushFrontier(frontier, node -> m_left);
+            }
+            if (node == m_bucketHead[bucket]) {
+                int next = nextBucket(bucket);
+                if (next >= 0) {
+                    pushFrontier(frontier, m_bucketHead[next]);
+                }
+            }
+        
+        } else if (m_structure == PAIRING) {
+            // Every child of a pairing heap node is a candidate, the siblings are not ordered
+            for (Node* child = node -> m_left; child; child = child -> m_right) {
+                pushFrontier(frontier, child);
+            }
+        
+        } else {
+            if (node -> m_left) pushFrontier(frontier, node -> m_left);
+            if (node -> m_right) pushFrontier(frontier, node -> m_right);
+        }
+    } while (!frontier.empty() && frontier.front() -> m_dead);
+}
+
+// pushFrontier(vector<Node*>& frontier, Node* node) const
+// Helper function of the frontier functions that adds a node to the frontier heap
+void PQueue::pushFrontier(vector<Node*>& frontier, Node* node) const {
+    frontier.push_back(node);
+    push_heap(frontier.begin(), frontier.end(), [this](Node* a, Node* b) { return isHigher(b, a); });
+}
+
+// const_iterator()
+// The end iterator has an empty frontier
+PQueue::const_iterator::const_iterator() {
+    m_queue = nullptr;
+}
+
+// const_iterator(const PQueue* queue)
+// An iterator to the highest priority patient of queue
+PQueue::const_iterator::const_iterator(const PQueue* queue) {
+    m_queue = queue;
+    queue -> startFrontier(m_frontier);
+}
+
+// operator*() const
+// Return the current patient
+const Patient& PQueue::const_iterator::operator*() const {
+    return m_frontier.front() -> m_patient;
+}
+
+// operator->() const
+// Return the address of the current patient
+const Patient* PQueue::const_iterator::operator->() const {
+    return &m_frontier.front() -> m_patient;
+}
+
+// operator++()
+// Move to the patient of the next lower priority
+PQueue::const_iterator& PQueue::const_iterator::operator++() {
+    m_queue -> advanceFrontier(m_frontier);
+    return *this;
+}
+
+// operator++(int)
+// Move to the patient of the next lower priority, returning the iterator before the move
+PQueue::const_iterator PQueue::const_iterator::operator++(int) {
+    const_iterator before = *this;
+    ++(*this);
+    return before;
+}
+
+// operator==(const const_iterator& rhs) const
+// Two iterators are equal when they are at the same patient, or both at the end
+bool PQueue::const_iterator::operator==(const const_iterator& rhs) const {
+    Node* node = m_frontier.empty() ? nullptr : m_frontier.front();
+    Node* rhsNode = rhs.m_frontier.empty() ? nullptr : rhs.m_frontier.front();
+    return node == rhsNode;
+}
+
+// operator!=(const const_iterator& rhs) const
+// Negation of operator==
+bool PQueue::const_iterator::operator!=(const const_iterator& rhs) const {
+    return !(*this == rhs);
+}
+
+// getPriorityFn() const
+// Return the current priority function
+prifn_t PQueue::getPriorityFn() const {
+    return m_priorFunc;
+}
+
+// numPatients() const
+// Return the current number of patients in the queue
+int PQueue::numPatients() const {
+    return m_size;
+}
+
+// getHeapType() const
+// Return the current type of the heap
+HEAPTYPE PQueue::getHeapType() const {
+    return m_heapType;
+}
+
+// getStructure() const
+// Return the current data structure of the heap
+STRUCTURE PQueue::getStructure() const {
+    return m_structure;
+}
+
+// getRoot() const
+// Helper function to get the root node of the queue
+Node* PQueue::getRoot() const {
+    return m_heap;
+}
+
+// snapshotChecksum(const char* data, size_t bytes, uint64_t hash)
+// FNV-1a over 32-bit words, continuing from hash; bytes is a multiple of 4
+static uint64_t snapshotChecksum(const char* data, size_t bytes, uint64_t hash) {
+    for (size_t offset = 0; offset < bytes; offset += 4) {
+        uint32_t word;
+        memcpy(&word, data + offset, 4);
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// saveSnapshot(const string& path) const
+// Write the header, the root indices and the records in one pass. The trees are written
+// breadth-first, the d-ary array in array order and the buckets in FIFO order
+void PQueue::saveSnapshot(const string& path) const {
+    vector<Node*> order;
+    order.reserve(m_size + m_numDead);
+    for (const DaryEntry& entry : m_dary) {
+        order.push_back(entry.node);
+    }
+    for (size_t bucket = 0; bucket < m_bucketHead.size(); bucket++) {
+        for (Node* node = m_bucketHead[bucket]; node; node = node -> m_left) {
+            order.push_back(node);
+        }
+    }
+    vector<int32_t> roots;
+    size_t firstTreeNode = order.size();
+    if (m_heap) {
+        order.push_back(m_heap);
+    }
+    for (Node* pending : m_pending) {
+        order.push_back(pending);
+    }
+    
+    // The main heap always has the first root slot, -1 when it is empty, so the
+    // pending heaps are melded in the same order after a restart
+    roots.push_back(m_heap ? (int32_t) firstTreeNode : -1);
+    for (size_t i = firstTreeNode + (m_heap ? 1 : 0); i < order.size(); i++) {
+        roots.push_back((int32_t) i);
+    }
+    
+    // The records of the trees are appended while the queue is walked, so the index of a
+    // child is the size of the order when it is reached
+    vector<SnapshotRecord> records;
+    records.reserve(m_size + m_numDead);
+    for (size_t i = 0; i < order.size(); i++) {
+        Node* node = order[i];
+        SnapshotRecord record;
+        memcpy(record.patient, &node -> m_patient, sizeof(Patient));
+        record.left = -1;
+        record.right = -1;
+        record.npl = node -> m_npl;
+        record.key = node -> getKey();
+        record.arrival = arrivalOf(node);
+        record.dead = node -> m_dead ? 1 : 0;
+        if (i >= firstTreeNode) {
+            if (node -> m_left) {
+                order.push_back(node -> m_left);
+                record.left = (int32_t) order.size() - 1;
+            }
+            if (node -> m_right) {
+                order.push_back(node -> m_right);
+                record.right = (int32_t) order.size() - 1;
+            }
+        }
+        records.push_back(record);
+    }
+    
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOTMAGIC, sizeof(header.magic));
+    header.version = SNAPSHOTVERSION;
+    header.byteOrder = SNAPSHOTBYTEORDER;
+    header.recordSize = sizeof(SnapshotRecord);
+    header.heapType = m_heapType;
+    header.structure = m_structure;
+    header.arity = m_arity;
+    header.hasKeyRange = m_hasKeyRange ? 1 : 0;
+    header.minKey = m_minKey;
+    header.maxKey = m_maxKey;
+    header.numRoots = roots.size();
+    header.numNodes = records.size();
+    header.numDead = m_numDead;
+    uint64_t checksum = snapshotChecksum((const char*) &header, sizeof(header), SNAPSHOTSEED);
+    checksum = snapshotChecksum((const char*) roots.data(), roots.size() * sizeof(int32_t), checksum);
+    header.checksum = snapshotChecksum((const char*) records.data(), records.size() * sizeof(SnapshotRecord), checksum);
+    
+    ofstream file(path, ios::binary | ios::trunc);
+    file.write((const char*) &header, sizeof(header));
+    file.write((const char*) roots.data(), roots.size() * sizeof(int32_t));
+    file.write((const char*) records.data(), records.size() * sizeof(SnapshotRecord));
+    if (!file) {
+        throw runtime_error("Cannot write the snapshot file " + path + ".");
+    }
+}
+
+// loadSnapshot(const string& path)
+// Read the whole file in one go and check it before the queue is touched, then take the
+// nodes from the pool and link them as the records say. The d-ary array keeps its order,
+// and the buckets are refilled in FIFO order, so no merge or sift runs
+void PQueue::loadSnapshot(const string& path) {
+    ifstream file(path, ios::binary | ios::ate);
+    if (!file) {
+        throw runtime_error("Cannot open the snapshot file " + path + ".");
+    }
+    size_t fileSize = (size_t) file.tellg();
+    file.seekg(0);
+    SnapshotHeader header;
+    if (fileSize < sizeof(header) || !file.read((char*) &header, sizeof(header))) {
+        throw runtime_error("The snapshot file " + path + " is truncated.");
+    }
+    if (memcmp(header.magic, SNAPSHOTMAGIC, sizeof(header.magic)) != 0 || header.version != SNAPSHOTVERSION ||
+        header.byteOrder != SNAPSHOTBYTEORDER || header.recordSize != sizeof(SnapshotRecord)) {
+        throw runtime_error("The file " + path + " isn't a snapshot of this version.");
+    }
+    if (header.numNodes > (uint64_t) INT32_MAX || header.numRoots > header.numNodes + 1 ||
+        fileSize != sizeof(header) + header.numRoots * sizeof(int32_t) + header.numNodes * sizeof(SnapshotRecord)) {
+        throw runtime_error("The snapshot file " + path + " is truncated.");
+    }
+    vector<int32_t> roots(header.numRoots);
+    // The records are plain bytes, they are read into storage that is never zeroed first
+    unique_ptr<SnapshotRecord[]> records(new SnapshotRecord[header.numNodes]);
+    file.read((char*) roots.data(), roots.size() * sizeof(int32_t));
+    file.read((char*) records.get(), header.numNodes * sizeof(SnapshotRecord));
+    // The header is hashed as it was written, with its checksum field still zero
+    SnapshotHeader hashed = header;
+    hashed.checksum = 0;
+    uint64_t checksum = snapshotChecksum((const char*) &hashed, sizeof(hashed), SNAPSHOTSEED);
+    checksum = snapshotChecksum((const char*) roots.data(), roots.size() * sizeof(int32_t), checksum);
+    checksum = snapshotChecksum((const char*) records.get(), header.numNodes * sizeof(SnapshotRecord), checksum);
+    if (!file || checksum != header.checksum) {
+        throw runtime_error("The snapshot file " + path + " is corrupted.");
+    }
+    
+    // The checksum catches damage, the shape is checked too so a bad writer can't build a
+    // cycle: every tree node is a root or the child of exactly one node placed before it.
+    // The nodes no one refers to are the d-ary array or the bucket lists
+    STRUCTURE structure = (STRUCTURE) header.structure;
+    bool isTree = (structure == SKEW || structure == LEFTIST || structure == PAIRING);
+    if ((header.heapType != MINHEAP && header.heapType != MAXHEAP) ||
+        header.structure < SKEW || header.structure > PAIRING || header.arity < 2 ||
+        (structure == BUCKET && (!header.hasKeyRange || header.minKey > header.maxKey ||
+                                 (long long) header.maxKey - header.minKey + 1 > MAXBUCKETS))) {
+        throw runtime_error("The snapshot file " + path + " is corrupted.");
+    }
+    int count = (int) header.numNodes;
+    vector<char> referenced(count, 0);
+    uint64_t numDead = 0;
+    bool valid = !roots.empty() && (isTree || roots.size() == 1) && (structure != DARY || roots[0] == -1);
+    for (size_t i = 0; i < roots.size() && valid; i++) {
+        valid = (i == 0 && roots[i] == -1) || (roots[i] >= 0 && roots[i] < count && !referenced[roots[i]]);
+        if (valid && roots[i] != -1) {
+            referenced[roots[i]] = 1;
+        }
+    }
+    for (int i = 0; i < count && valid; i++) {
+        const SnapshotRecord& record = records[i];
+        for (int32_t child : {record.left, record.right}) {
+            valid = valid && (child == -1 || (child > i && child < count && !referenced[child]));
+            if (valid && child != -1) {
+                referenced[child] = 1;
+            }
+        }
+        valid = valid && (!isTree || referenced[i]);
+        numDead += record.dead ? 1 : 0;
+    }
+    if (!valid || numDead != header.numDead) {
+        throw runtime_error("The snapshot file " + path + " is corrupted.");
+    }
+    
+    clear();
+    m_heapType = (HEAPTYPE) header.heapType;
+    m_structure = structure;
+    m_arity = header.arity;
+    m_hasKeyRange = header.hasKeyRange != 0;
+    m_minKey = header.minKey;
+    m_maxKey = header.maxKey;
+    resetBuckets();
+    m_pool.reserve(count);
+    vector<Node*> nodes(count);
+    for (int i = 0; i < count; i++) {
+        nodes[i] = m_pool.allocate();
+        PQUEUE_COUNT(m_counters.m_allocations);
+        memcpy(&nodes[i] -> m_patient, records[i].patient, sizeof(Patient));
+        nodes[i] -> m_key = packKey(records[i].key, records[i].arrival);
+        nodes[i] -> m_npl = records[i].npl;
+        nodes[i] -> m_dead = records[i].dead != 0;
+        m_arrivals = max(m_arrivals, records[i].arrival + 1);
+    }
+    // Both children link back to the node, in a pairing heap the next sibling's
+    // back link is the previous sibling, which is this node as well
+    for (int i = 0; i < count; i++) {
+        if (records[i].left != -1) {
+            nodes[i] -> m_left = nodes[records[i].left];
+            nodes[i] -> m_left -> m_parent = nodes[i];
+        }
+        if (records[i].right != -1) {
+            nodes[i] -> m_right = nodes[records[i].right];
+            nodes[i] -> m_right -> m_parent = nodes[i];
+        }
+    }
+    m_heap = (roots[0] == -1) ? nullptr : nodes[roots[0]];
+    for (size_t i = 1; i < roots.size(); i++) {
+        m_pending.push_back(nodes[roots[i]]);
+    }
+    
+    if (structure == DARY) {
+        // The array was saved in heap order, each node only needs its index back
+        m_dary.reserve(count);
+        for (int i = 0; i < count; i++) {
+            m_dary.push_back({nodes[i] -> m_key, nodes[i]});
+            nodes[i] -> m_npl = i;
+        }
+    } else if (structure == BUCKET) {
+        // The bucket lists were saved in FIFO order, appending keeps it
+        for (int i = 0; i < count; i++) {
+            if (!referenced[i]) {
+                pushNode(nodes[i]);
+            }
+        }
+    }
+    m_numDead = (int) numDead;
+    m_size = count - m_numDead;
 }
 
 // dump() const
 // Visualize the desired data structure
 void PQueue::dump() const {
-  if (m_size == 0) {
+  if (m_size + m_numDead == 0) {
     cout << "Empty heap.\n" ;
       
+  } else if (m_structure == BUCKET) {
+    for (int bucket = firstBucket(); bucket >= 0; bucket = nextBucket(bucket)) {
+      cout << "[" << bucket + m_minKey << ":";
+      for (Node* node = m_bucketHead[bucket]; node; node = node -> m_left)
+        cout << " " << node -> m_patient.getPatient();
+      cout << "]";
+    }
+    dump(m_heap);
+      
+  } else if (m_structure == DARY) {
+    for (size_t index = 0; index < m_dary.size(); index++) {
+      if (index > 0 && (index - 1) % m_arity == 0)
+        cout << " |";
+      cout << " " << m_dary[index].node -> getKey() << ":" << m_dary[index].node -> m_patient.getPatient();
+    }
+      
   } else {
     dump(m_heap);
+    for (Node* pending : m_pending) {
+      cout << " +";
+      dump(pending);
+    }
   }
   cout << endl;
 }
@@ -336,16 +2014,343 @@ void PQueue::dump(Node *pos) const {
     cout << "(";
     dump(pos -> m_left);
       
-    if (m_structure == SKEW)
-        cout << m_priorFunc(pos -> m_patient) << ":" << pos -> m_patient.getPatient();
+    if (m_structure != LEFTIST)
+        cout << pos -> getKey() << ":" << pos -> m_patient.getPatient();
     else
-        cout << m_priorFunc(pos -> m_patient) << ":" << pos -> m_patient.getPatient() << ":" << pos -> m_npl;
+        cout << pos -> getKey() << ":" << pos -> m_patient.getPatient() << ":" << pos -> m_npl;
       
     dump(pos->m_right);
     cout << ")";
   }
 }
 
+// stats() const
+// Return the operation counters and measure the shape of the heaps. The right spine is
+// that of the main heap, the depth and NPL distribution cover every tree of the queue
+PQueueStats PQueue::stats() const {
+    PQueueStats stats;
+    stats.m_counters = m_counters;
+    stats.m_size = m_size;
+    stats.m_numDead = m_numDead;
+    
+    if (m_structure == DARY) {
+        // The last entry of the array is on the deepest level
+        for (int index = (int) m_dary.size() - 1; index > 0; index = (index - 1) / m_arity) {
+            stats.m_maxDepth++;
+        }
+        return stats;
+    }
+    
+    if (m_structure == PAIRING) {
+        for (Node* child = m_heap ? m_heap -> m_left : nullptr; child; child = child -> m_right) {
+            stats.m_rightSpine++;
+        }
+    } else {
+        for (Node* node = m_heap; node; node = node -> m_right) {
+            stats.m_rightSpine++;
+        }
+    }
+    measureTree(m_heap, stats);
+    for (Node* pending : m_pending) {
+        measureTree(pending, stats);
+    }
+    return stats;
+}
+
+// measureTree(Node* root, PQueueStats& stats) const
+// Helper function of stats() const that walks a tree level by level for its depth, then
+// computes the null path lengths bottom up. A pairing heap node keeps its children in a
+// sibling list, so it has a depth but no null path length
+void PQueue::measureTree(Node* root, PQueueStats& stats) const {
+    if (!root) {
+        return;
+    }
+    vector<Node*> order(1, root);
+    vector<int> parent(1, -1);
+    vector<int> depth(1, 0);
+    for (size_t i = 0; i < order.size(); i++) {
+        Node* node = order[i];
+        if (depth[i] > stats.m_maxDepth) {
+            stats.m_maxDepth = depth[i];
+        }
+        if (m_structure == PAIRING) {
+            for (Node* child = node -> m_left; child; child = child -> m_right) {
+                order.push_back(child);
+                parent.push_back((int) i);
+                depth.push_back(depth[i] + 1);
+            }
+        } else {
+            for (Node* child : {node -> m_left, node -> m_right}) {
+                if (child) {
+                    order.push_back(child);
+                    parent.push_back((int) i);
+                    depth.push_back(depth[i] + 1);
+                }
+            }
+        }
+    }
+    if (m_structure == PAIRING) {
+        return;
+    }
+    
+    // A node with a missing child has a null path length of 0, otherwise one more than
+    // its lower child; children come after their parent in the order
+    vector<int> children(order.size(), 0);
+    vector<int> lowest(order.size(), 0);
+    for (int i = (int) order.size() - 1; i >= 0; i--) {
+        int npl = (children[i] < 2) ? 0 : lowest[i] + 1;
+        if ((int) stats.m_nplCounts.size() <= npl) {
+            stats.m_nplCounts.resize(npl + 1, 0);
+        }
+        stats.m_nplCounts[npl]++;
+        if (parent[i] >= 0) {
+            int up = parent[i];
+            lowest[up] = (children[up] == 0) ? npl : min(lowest[up], npl);
+            children[up]++;
+        }
+    }
+}
+
+// dumpStats(bool json) const
+// Print the statistics on one line, as name=value pairs or as a JSON object
+void PQueue::dumpStats(bool json) const {
+    PQueueStats current = stats();
+    cout << (json ? current.toJSON() : current.toText()) << endl;
+}
+
+// resetCounters()
+// Start counting the operations from zero
+void PQueue::resetCounters() {
+    m_counters = PQueueCounters();
+}
+
+// toText() const
+// Return the statistics as space separated name=value pairs
+string PQueueStats::toText() const {
+    string text = "size=" + to_string(m_size) + " dead=" + to_string(m_numDead) +
+                  " rightSpine=" + to_string(m_rightSpine) + " maxDepth=" + to_string(m_maxDepth) +
+                  " merges=" + to_string(m_counters.m_merges) +
+                  " comparisons=" + to_string(m_counters.m_comparisons) +
+                  " priorityCalls=" + to_string(m_counters.m_priorityCalls) +
+                  " swaps=" + to_string(m_counters.m_swaps) +
+                  " allocations=" + to_string(m_counters.m_allocations) +
+                  " rebuilds=" + to_string(m_counters.m_rebuilds) + " npl=";
+    for (size_t npl = 0; npl < m_nplCounts.size(); npl++) {
+        text += (npl > 0 ? "," : "") + to_string(m_nplCounts[npl]);
+    }
+    return text;
+}
+
+// toJSON() const
+// Return the statistics as a JSON object, nplCounts[k] is the number of nodes with NPL k
+string PQueueStats::toJSON() const {
+    string json = "{\"size\":" + to_string(m_size) + ",\"dead\":" + to_string(m_numDead) +
+                  ",\"rightSpine\":" + to_string(m_rightSpine) + ",\"maxDepth\":" + to_string(m_maxDepth) +
+                  ",\"merges\":" + to_string(m_counters.m_merges) +
+                  ",\"comparisons\":" + to_string(m_counters.m_comparisons) +
+                  ",\"priorityCalls\":" + to_string(m_counters.m_priorityCalls) +
+                  ",\"swaps\":" + to_string(m_counters.m_swaps) +
+                  ",\"allocations\":" + to_string(m_counters.m_allocations) +
+                  ",\"rebuilds\":" + to_string(m_counters.m_rebuilds) + ",\"nplCounts\":[";
+    for (size_t npl = 0; npl < m_nplCounts.size(); npl++) {
+        json += (npl > 0 ? "," : "") + to_string(m_nplCounts[npl]);
+    }
+    return json + "]}";
+}
+
+// slabBefore(const pair<Node*, int>& lhs, const pair<Node*, int>& rhs)
+// Helper function of NodePool that orders slabs by address; std::less gives a total order
+// even for pointers into different arrays
+static bool slabBefore(const pair<Node*, int>& lhs, const pair<Node*, int>& rhs) {
+    return less<const Node*>()(lhs.first, rhs.first);
+}
+
+// NodePool()
+// The default constructor creates an empty pool, slabs are added on demand
+NodePool::NodePool() {
+    m_free = nullptr;
+    m_freeTail = nullptr;
+    m_numFree = 0;
+    m_capacity = 0;
+    m_nextSlab = MINSLAB;
+}
+
+// ~NodePool()
+// The destructor releases every slab
+NodePool::~NodePool() {
+    release();
+}
+
+// allocate()
+// Take a node from the free list, adding a new slab when it runs out
+Node* NodePool::allocate() {
+    if (!m_free) {
+        addSlab(m_nextSlab);
+    }
+    
+    Node* node = m_free;
+    m_free = node -> m_right;
+    if (!m_free) {
+        m_freeTail = nullptr;
+    }
+    m_numFree--;
+    
+    node -> m_right = nullptr;
+    node -> m_left = nullptr;
+    node -> m_parent = nullptr;
+    node -> m_npl = 0;
+    node -> m_dead = false;
+    return node;
+}
+
+// allocate(const Patient& patient)
+// Allocate a node holding a copy of the patient
+Node* NodePool::allocate(const Patient& patient) {
+    Node* node = allocate();
+    node -> m_patient = patient;
+    return node;
+}
+
+// allocate(Patient&& patient)
+// Allocate a node and move the patient into it
+Node* NodePool::allocate(Patient&& patient) {
+    Node* node = allocate();
+    node -> m_patient = move(patient);
+    return node;
+}
+
+// deallocate(Node* node)
+// Return a node to the free list so it can be recycled
+void NodePool::deallocate(Node* node) {
+    node -> m_stamp++;
+    node -> m_parent = nullptr;
+    node -> m_left = nullptr;
+    node -> m_right = m_free;
+    if (!m_free) {
+        m_freeTail = node;
+    }
+    m_free = node;
+    m_numFree++;
+}
+
+// reserve(int n)
+// Make sure n nodes can be allocated without adding another slab
+void NodePool::reserve(int n) {
+    if (n > m_numFree) {
+        addSlab(n - m_numFree);
+    }
+}
+
+// release()
+// Bulk release of every slab, all the nodes handed out become invalid
+void NodePool::release() {
+    for (const pair<Node*, int>& slab : m_slabs) {
+        delete [] slab.first;
+    }
+    m_slabs.clear();
+    m_free = nullptr;
+    m_freeTail = nullptr;
+    m_numFree = 0;
+    m_capacity = 0;
+    m_nextSlab = MINSLAB;
+}
+
+// absorb(NodePool& rhs)
+// Take over the slabs and the free nodes of rhs, used when two heaps are merged
+void NodePool::absorb(NodePool& rhs) {
+    if (this == &rhs) {
+        return;
+    }
+    
+    // The nodes of rhs belong to this pool from now on, so its handles follow them
+    vector<pair<Node*, int>> slabs;
+    slabs.reserve(m_slabs.size() + rhs.m_slabs.size());
+    std::merge(m_slabs.begin(), m_slabs.end(), rhs.m_slabs.begin(), rhs.m_slabs.end(),
+               back_inserter(slabs), slabBefore);
+    m_slabs.swap(slabs);
+    m_capacity += rhs.m_capacity;
+    
+    // Splice the free list of rhs at the end of this free list
+    if (rhs.m_free) {
+        if (m_freeTail) {
+            m_freeTail -> m_right = rhs.m_free;
+        } else {
+            m_free = rhs.m_free;
+        }
+        m_freeTail = rhs.m_freeTail;
+        m_numFree += rhs.m_numFree;
+    }
+    
+    rhs.m_slabs.clear();
+    rhs.m_free = nullptr;
+    rhs.m_freeTail = nullptr;
+    rhs.m_numFree = 0;
+    rhs.m_capacity = 0;
+    rhs.m_nextSlab = MINSLAB;
+}
+
+// swap(NodePool& rhs)
+// Exchange every slab and free node with rhs, used to move a heap to another queue
+void NodePool::swap(NodePool& rhs) {
+    m_slabs.swap(rhs.m_slabs);
+    std::swap(m_free, rhs.m_free);
+    std::swap(m_freeTail, rhs.m_freeTail);
+    std::swap(m_numFree, rhs.m_numFree);
+    std::swap(m_capacity, rhs.m_capacity);
+    std::swap(m_nextSlab, rhs.m_nextSlab);
+}
+
+// owns(const Node* node) const
+// Check the node lies in one of the slabs of this pool, i.e. it belongs to this queue
+bool NodePool::owns(const Node* node) const {
+    less<const Node*> before;
+    auto slab = upper_bound(m_slabs.begin(), m_slabs.end(), node,
+                            [&](const Node* lhs, const pair<Node*, int>& rhs) {
+                                return before(lhs, rhs.first);
+                            });
+    if (slab == m_slabs.begin()) {
+        return false;
+    }
+    --slab;
+    return before(node, slab -> first + slab -> second);
+}
+
+// capacity() const
+// Return the total number of nodes in all slabs
+int NodePool::capacity() const {
+    return m_capacity;
+}
+
+// numFree() const
+// Return the number of nodes that can be allocated without a new slab
+int NodePool::numFree() const {
+    return m_numFree;
+}
+
+// addSlab(int size)
+// Allocate a slab of nodes and thread all of them onto the free list
+void NodePool::addSlab(int size) {
+    Node* slab = new Node[size];
+    pair<Node*, int> entry(slab, size);
+    m_slabs.insert(upper_bound(m_slabs.begin(), m_slabs.end(), entry, slabBefore), entry);
+    m_capacity += size;
+    
+    for (int i = 0; i < size - 1; i++) {
+        slab[i].m_right = &slab[i + 1];
+    }
+    slab[size - 1].m_right = m_free;
+    if (!m_free) {
+        m_freeTail = &slab[size - 1];
+    }
+    m_free = slab;
+    m_numFree += size;
+    
+    // Slabs double in size so a large queue only needs a few of them
+    if (m_nextSlab < MAXSLAB) {
+        m_nextSlab *= 2;
+    }
+}
+
 ostream& operator<<(ostream& sout, const Patient& patient) {
   sout  << patient.getPatient()
         << ", temperature: " << patient.getTemperature()
@@ -5,15 +5,26 @@
 #include <stdexcept>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <iterator>
+#include <utility>
+#include <cstring>
+#include <type_traits>
+#include <algorithm>
 using namespace std;
 
 class Grader; // forward declaration (for grading purposes)
 class Tester; // forward declaration (for test functions)
 class PQueue; // forward declaration
 class Patient;// forward declaration
+class NodePool;// forward declaration
+class ConcurrentPQueue;// forward declaration
+class PatientHandle;// forward declaration
+class PatientFeed;// forward declaration
+class LatencyRecorder;// forward declaration
 #define EMPTY Patient() // This is an empty object (invalid patient)
 enum HEAPTYPE {MINHEAP, MAXHEAP};
-enum STRUCTURE {SKEW, LEFTIST};
+enum STRUCTURE {SKEW, LEFTIST, BUCKET, DARY, PAIRING};
 // Priority function pointer type
 typedef int (*prifn_t)(const Patient&);
 
@@ -28,59 +39,72 @@ const int MINBP = 70;   // Blood Pressure
 const int MAXBP = 160;
 const int MINOPINION = 1;   // Nurse opinion, between 1 - 10
 const int MAXOPINION = 10;  // 1 is highest priotity
+const int MAXNAME = 18;     // Longest name kept with a patient, longer names are cut
+const int MAXBUCKETS = 65536;  // Widest key range a BUCKET queue accepts
+const int DEFAULTARITY = 4;    // Children per node of a DARY heap
+const double DEFAULTDEADFRACTION = 0.25; // Cancelled patients per live patient before compaction
+// A node is ordered by one 64-bit key: the priority with its sign bit flipped (so it sorts
+// as unsigned) in the high half and the arrival number in the low half, inverted in a
+// max-heap, so equal priorities leave in the order they arrived with a single comparison
+const unsigned int KEYSIGN = 0x80000000u;
+
+// Instrumentation: built with -DPQUEUE_STATS the queue counts its operations, otherwise
+// PQUEUE_COUNT compiles to nothing and the counters of stats() stay zero
+#ifdef PQUEUE_STATS
+#define PQUEUE_COUNT(counter) (++(counter))
+#else
+#define PQUEUE_COUNT(counter) ((void) 0)
+#endif
 //
 // patient class
 //
+// The record is compact and trivially copyable: the name lives in an inline
+// buffer and every triage parameter fits in a byte, so copying a patient is a
+// plain memory copy. The getters and setters still take and return int/string.
 class Patient {
     public:
     friend class Grader; // for grading purposes
     friend class Tester; // contains test functions
     friend class PQueue;
+    friend class PatientFeed; // fills checked records directly
     Patient() {
         // This is an empty object since name is empty
-        m_patient = ""; m_temperature = 37; m_oxygen = 100;
+        setPatient(""); m_temperature = 37; m_oxygen = 100;
         m_RR = 20;m_BP = 100;m_opinion=10;
     }
-    Patient(string name, int temp, int ox, int rr, int bp, int op) {
+    Patient(const string& name, int temp, int ox, int rr, int bp, int op) {
         if ( (temp < MINTEMP || temp > MAXTEMP) ||
         (ox < MINOX || ox > MAXOX) || (rr < MINRR || rr > MAXRR) ||
         (bp < MINBP || bp > MAXBP) || (op < 1 || op > 10)){
             // create an empty object
-            m_patient = ""; m_temperature = 37; m_oxygen = 100;
+            setPatient(""); m_temperature = 37; m_oxygen = 100;
             m_RR = 20; m_BP = 100;m_opinion=10;
         }
         else{
-            m_patient = name; m_temperature = temp; m_oxygen = ox;
+            setPatient(name); m_temperature = temp; m_oxygen = ox;
             m_RR = rr; m_BP = bp;m_opinion=op;
         }
     }
-    string getPatient() const {return m_patient;}
+    string getPatient() const {return string(m_patient);}
     int getTemperature() const {return m_temperature;}
     int getOxygen() const {return m_oxygen;}
     int getRR() const {return m_RR;}
     int getBP() const {return m_BP;}
     int getOpinion() const {return m_opinion;}
-    void setPatient(string name) {m_patient=name;}
-    void setTemperature(int val) {m_temperature=val;}
-    void setOxygen(int val) {m_oxygen=val;}
-    void setRR(int val) {m_RR=val;}
-    void setBP(int val) {m_BP=val;}
-    void setOpinion(int val) {m_opinion=val;}
-    // Overloaded assignment operator
-    const Patient & operator=(const Patient& rhs){
-        if (this != &rhs){
-            m_patient = rhs.m_patient;
-            m_temperature = rhs.m_temperature;
-            m_oxygen = rhs.m_oxygen;
-            m_RR = rhs.m_RR;
-            m_BP = rhs.m_BP;
-            m_opinion = rhs.m_opinion;
-        }
-        return *this;
+    void setPatient(const string& name) {
+        // The unused tail of the buffer is zeroed so equal names compare equal byte by byte
+        strncpy(m_patient, name.c_str(), MAXNAME);
+        m_patient[MAXNAME] = '\0';
     }
+    // A value outside its triage range would not fit its byte, the record is left unchanged
+    void setTemperature(int val) {if (val >= MINTEMP && val <= MAXTEMP) m_temperature=val;}
+    void setOxygen(int val) {if (val >= MINOX && val <= MAXOX) m_oxygen=val;}
+    void setRR(int val) {if (val >= MINRR && val <= MAXRR) m_RR=val;}
+    void setBP(int val) {if (val >= MINBP && val <= MAXBP) m_BP=val;}
+    void setOpinion(int val) {if (val >= MINOPINION && val <= MAXOPINION) m_opinion=val;}
     // Overloaded equality operator
     bool operator==(const Patient & rhs) const {
-        return ((m_patient == rhs.m_patient) &&
+        return ((memcmp(m_patient, rhs.m_patient, sizeof(m_patient)) == 0) &&
                 (m_temperature == rhs.m_temperature) &&
                 (m_oxygen == rhs.m_oxygen) &&
                 (m_RR == rhs.m_RR) &&
@@ -91,29 +115,48 @@ class Patient {
     friend ostream& operator<<(ostream& sout, const Patient& patient);
 
     private:
-    string m_patient;  // Patient's name, no need to be unique
-    int m_temperature; // Body temperature, celsius
-    int m_oxygen;      // Level of oxygen saturation (SpO2), percentage
-    int m_RR;          // Respiratory Rate, per minute
-    int m_BP;          // Blood Pressure
-    int m_opinion;     // Nurse opinion, 1 - 10
+    char m_patient[MAXNAME + 1];  // Patient's name, no need to be unique
+    unsigned char m_temperature;  // Body temperature, celsius
+    unsigned char m_oxygen;       // Level of oxygen saturation (SpO2), percentage
+    unsigned char m_RR;           // Respiratory Rate, per minute
+    unsigned char m_BP;           // Blood Pressure
+    unsigned char m_opinion;      // Nurse opinion, 1 - 10
 };
+static_assert(is_trivially_copyable<Patient>::value, "Patient must stay trivially copyable");
 
 class Node {
-    // this is a node in the skew/leftist heap
+    // this is a node in the skew/leftist heap; in a pairing heap m_left is
+    // the first child and m_right the next sibling, and m_parent links back to
+    // the parent (to the previous sibling in a pairing heap or a bucket)
     public:
     friend class Grader; // for grading purposes
     friend class Tester; // contains test functions
     friend class PQueue;
+    friend class NodePool;
+    Node() {
+        // slab storage, the patient is assigned when the node is allocated
+        m_right = nullptr;
+        m_left = nullptr;
+        m_parent = nullptr;
+        m_npl = 0;
+        m_key = 0;
+        m_stamp = 0;
+        m_dead = false;
+    }
     Node(Patient patient) {
-        m_patient = patient;
+        m_patient = move(patient);
         m_right = nullptr;
         m_left = nullptr;
+        m_parent = nullptr;
         m_npl = 0;
+        m_key = 0;
+        m_stamp = 0;
+        m_dead = false;
     }
     Patient getPatient() const {return m_patient;}
     void setNPL(int npl) {m_npl = npl;}
     int getNPL() const {return m_npl;}
+    int getKey() const {return (int) ((unsigned int) (m_key >> 32) ^ KEYSIGN);}
 
     // Overloaded insertion operator
     friend ostream& operator<<(ostream& sout, const Node& node);
@@ -122,7 +165,88 @@ class Node {
     Patient m_patient;   // Patient information
     Node *m_right;       // Right child
     Node *m_left;        // Left child
-    int m_npl;           // null path length for leftist heap
+    Node *m_parent;      // Parent, previous sibling or previous patient of a bucket
+    unsigned long long m_key; // cached priority and arrival number packed as described at KEYSIGN
+    int m_npl;           // null path length for leftist heap, array index for d-ary heap
+    unsigned int m_stamp : 31; // bumped every time the node is freed, so old handles go stale;
+                               // one bit short of an int so the node stays in 64 bytes
+    unsigned int m_dead : 1;   // tombstone of a cancelled patient, freed when it reaches the top
+};
+static_assert(sizeof(Node) <= 64, "Node must fit in a cache line");
+
+class PatientHandle {
+    // stable reference to a patient in a queue, returned by insertPatient
+    // It stays valid across rebuilds, setStructure and mergeWithQueue (it then
+    // refers to the merged queue) until the patient leaves the queue. It must not
+    // be used once its queue is cleared or destroyed.
+    public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // contains test functions
+    friend class PQueue;
+    PatientHandle() {
+        m_node = nullptr;
+        m_stamp = 0;
+    }
+
+    private:
+    Node* m_node;           // node of the patient
+    unsigned int m_stamp;   // stamp of the node when the patient was inserted
+};
+
+class NodePool {
+    // slab allocator that owns every node of a heap, recycled nodes are
+    // kept in a free list threaded through m_right
+    public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // contains test functions
+    NodePool();
+    ~NodePool();
+    Node* allocate();         // the caller assigns the patient
+    Node* allocate(const Patient& patient);
+    Node* allocate(Patient&& patient);
+    void deallocate(Node* node);
+    void reserve(int n);      // make sure n nodes can be allocated without a new slab
+    void release();           // bulk release of every slab
+    void absorb(NodePool& rhs); // take over the slabs and free nodes of rhs
+    void swap(NodePool& rhs);   // exchange all slabs with rhs in O(1)
+    bool owns(const Node* node) const; // check the node lies in one of the slabs
+    int capacity() const;
+    int numFree() const;
+
+    private:
+    vector<pair<Node*, int>> m_slabs; // every slab allocated with new[] and its size,
+                                      // sorted by address so owns() is a binary search
+    Node* m_free;           // head of the free list
+    Node* m_freeTail;       // tail of the free list, for O(1) absorb
+    int m_numFree;          // number of nodes in the free list
+    int m_capacity;         // total number of nodes in all slabs
+    int m_nextSlab;         // size of the next slab, doubles up to MAXSLAB
+
+    NodePool(const NodePool& rhs);            // a pool is never copied
+    NodePool& operator=(const NodePool& rhs);
+    void addSlab(int size);
+};
+
+// Operation counters of a queue, zero unless it is built with PQUEUE_STATS
+struct PQueueCounters {
+    long long m_merges = 0;         // merge and meld calls
+    long long m_comparisons = 0;    // key comparisons
+    long long m_priorityCalls = 0;  // calls of the priority function
+    long long m_swaps = 0;          // left/right child swaps
+    long long m_allocations = 0;    // nodes taken from the pool
+    long long m_rebuilds = 0;       // whole-structure rebuilds
+};
+
+// The counters and the shape of a queue, returned by PQueue::stats()
+struct PQueueStats {
+    PQueueCounters m_counters;
+    int m_size = 0;         // live patients
+    int m_numDead = 0;      // tombstones
+    int m_rightSpine = 0;   // nodes on the right spine of the main heap, children of the root of a pairing heap
+    int m_maxDepth = 0;     // edges from a root down to the deepest node
+    vector<int> m_nplCounts;// m_nplCounts[k] is the number of tree nodes with a null path length of k
+    string toText() const;  // one line of name=value pairs
+    string toJSON() const;  // one line JSON object
 };
 
 class PQueue {
@@ -130,15 +254,76 @@ class PQueue {
 public:
     friend class Grader; // for grading purposes
     friend class Tester; // contains test functions
+    friend class ConcurrentPQueue; // reads the top key of its sub-queues
     PQueue(prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure);
+    // Declare the range of keys the priority function yields, the queue then
+    // keeps one FIFO bucket per key (BUCKET structure)
+    PQueue(prifn_t priFn, HEAPTYPE heapType, int minKey, int maxKey);
+    // Build the queue from a range of patients in O(n)
+    template <class Iterator>
+    PQueue(Iterator first, Iterator last, prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure);
     ~PQueue();
     PQueue(const PQueue& rhs);
     PQueue& operator=(const PQueue& rhs);
-    void insertPatient(const Patient& input);
+    // Move constructor and move assignment steal the heap and its node pool in O(1)
+    PQueue(PQueue&& rhs) noexcept;
+    PQueue& operator=(PQueue&& rhs) noexcept;
+    // Both return a handle to the queued patient for updatePatient and removePatient
+    // Patients of equal priority leave in the order they were inserted
+    PatientHandle insertPatient(const Patient& input);
+    PatientHandle insertPatient(Patient&& input);
+    // Construct the patient in place from the Patient constructor arguments
+    template <class... Args>
+    PatientHandle emplacePatient(Args&&... args);
+    // Replace the patient of a handle, e.g. with new vitals, and move it to its new
+    // place; O(log n) for leftist and d-ary heaps, amortized for skew and pairing heaps.
+    // In a bucket queue the patient goes behind the earlier arrivals of its new bucket,
+    // O(later arrivals in that bucket)
+    void updatePatient(const PatientHandle& handle, const Patient& patient);
+    // Remove and return the patient of a handle wherever it is in the queue
+    Patient removePatient(const PatientHandle& handle);
+    // Check the patient of a handle is still in the queue
+    bool contains(const PatientHandle& handle) const;
+    // Drop a patient who left without being seen in O(1). The node stays in the
+    // queue as a tombstone until it reaches the top or the queue is compacted.
+    void cancelPatient(const PatientHandle& handle);
+    // Free every tombstone now with a linear rebuild
+    void compact();
+    // Compact automatically once the tombstones exceed this fraction of the live patients
+    void setMaxDeadFraction(double fraction);
+    double getMaxDeadFraction() const;
+    // Insert a range of patients, the nodes are allocated in one block and
+    // heapified pairwise in O(n) before they are merged with the queue
+    template <class Iterator>
+    void insertPatients(Iterator first, Iterator last);
     Patient getNextPatient();
+    // Remove the k highest priority patients in one pass and write them to out in
+    // priority order; returns the number written, fewer than k if the queue runs out
+    template <class OutputIterator>
+    int getNextPatients(int k, OutputIterator out);
+    // Each queue numbers its own arrivals, so equal priorities from the two queues
+    // keep their order within each queue but not between them
     void mergeWithQueue(PQueue& rhs);
+    // Merge every queue of queues into this one with a balanced tournament whose
+    // independent pairs run on numThreads threads (one per core when it is 0).
+    // The priority functions must match; a queue of another structure is
+    // converted first. All the queues given are left empty.
+    void mergeAll(const vector<PQueue*>& queues, int numThreads = 0);
+    // In lazy merge mode mergeWithQueue only appends the heap of rhs to a pending
+    // list in O(1); the pending heaps are melded pairwise by the next dequeue.
+    // Only the skew, leftist and pairing structures defer their merges.
+    void setLazyMerge(bool lazy);
+    bool getLazyMerge() const;
+    // Record the latency of every insertPatient, getNextPatient, mergeWithQueue and
+    // rebuild in recorder (see latencyhistogram.h); null stops recording. The recorder
+    // is not owned and may be shared by several queues and threads
+    void setLatencyRecorder(LatencyRecorder* recorder);
+    LatencyRecorder* getLatencyRecorder() const;
     void clear();
-    int numPatients() const;
+    // Pre-size the node pool so that n patients fit without growing it
+    void reserve(int n);
+    int numPatients() const;   // live patients, tombstones are not counted
+    int numDead() const;       // tombstones still holding a node
     // Print the queue using preorder traversal.  Although the first patient
     // printed should have the highest priority, the remaining patients will
     // not necessarily be in priority order.
@@ -148,34 +333,207 @@ public:
     void setPriorityFn(prifn_t priFn, HEAPTYPE heapType);
     HEAPTYPE getHeapType() const;
     STRUCTURE getStructure() const;
-    // Set a new data structure (skew/leftist). Must rebuild the heap!!!
+    // Set a new data structure (skew/leftist/bucket/dary/pairing). Must rebuild the heap!!!
     void setStructure(STRUCTURE structure);
+    // Set the number of children per node of the DARY heap, at least 2
+    void setArity(int arity);
+    int getArity() const;
+    // Declare the key range of the priority function and switch to BUCKET.
+    // Keys outside the range go to an overflow skew heap.
+    void setKeyRange(int minKey, int maxKey);
+    // Write the queue to a versioned binary snapshot that keeps the heap shape, the
+    // cached keys and the tombstones. loadSnapshot replaces the contents of this
+    // queue with the snapshot without running a single merge, and throws
+    // runtime_error for a missing, truncated or corrupted file. The priority
+    // function isn't saved, a snapshot must be loaded with the one it was taken with.
+    void saveSnapshot(const string& path) const;
+    void loadSnapshot(const string& path);
     void dump() const;  // For debugging purposes.
+    // The operation counters and the measured shape of the heaps, and a one-line
+    // text or JSON dump of them
+    PQueueStats stats() const;
+    void dumpStats(bool json = false) const;
+    void resetCounters();
+
+    // Read-only iterator that visits the patients in priority order without changing
+    // the queue. The order is produced lazily from a small frontier heap of the nodes
+    // whose parents were already visited, so the first k patients cost O(k log k).
+    // PAIRING is the exception: siblings are unordered, so each step reads every child
+    // of the node it leaves. Every insert adds a child to the root and only dequeues pair
+    // them up, so peeking a pairing heap filled one insert at a time costs O(n).
+    // Any change to the queue invalidates its iterators.
+    class const_iterator {
+    public:
+        typedef forward_iterator_tag iterator_category;
+        typedef Patient value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const Patient* pointer;
+        typedef const Patient& reference;
+        const_iterator();
+        const Patient& operator*() const;
+        const Patient* operator->() const;
+        const_iterator& operator++();
+        const_iterator operator++(int);
+        bool operator==(const const_iterator& rhs) const;
+        bool operator!=(const const_iterator& rhs) const;
+
+    private:
+        friend class PQueue;
+        const PQueue* m_queue;      // queue being walked
+        vector<Node*> m_frontier;   // heap of the next candidates, the next patient in front
+        explicit const_iterator(const PQueue* queue);
+    };
+    const_iterator begin() const;
+    const_iterator end() const;
+    // Return copies of the k highest priority patients in priority order, fewer if the
+    // queue is smaller; the queue is not changed. Costs as const_iterator, see there
+    vector<Patient> peekTopK(int k) const;
 
 private:
     Node * m_heap;          // Pointer to root of skew heap
-    int m_size;             // Current size of the heap
+    int m_size;             // Current number of live patients
+    int m_numDead;          // Cancelled patients still in the data structure
+    unsigned int m_arrivals;// arrival number of the next patient, breaks ties first-come-first-served
+    double m_maxDeadFraction; // tombstones per live patient that trigger a compaction
     prifn_t m_priorFunc;    // Function to compute priority
     HEAPTYPE m_heapType;    // either a MINHEAP or a MAXHEAP
     STRUCTURE m_structure;  // skew heap or leftist heap
+    NodePool m_pool;        // owns every node of the heap
+
+    vector<Node*> m_path;   // merge path scratch space, reused by every merge
+    vector<Node*> m_pending;// heaps merged lazily and not yet melded with m_heap
+    bool m_lazyMerge;       // true when mergeWithQueue defers the melding
+    LatencyRecorder* m_latency; // histograms of the operation latencies, null when not recorded
+    mutable PQueueCounters m_counters; // counted by const comparisons too
+
+    // BUCKET structure: one FIFO list per key, linked through m_left, and a
+    // bitmap of the non-empty buckets; m_heap is the overflow skew heap
+    vector<Node*> m_bucketHead;   // first patient of each bucket
+    vector<Node*> m_bucketTail;   // last patient of each bucket
+    vector<unsigned long long> m_bucketBits; // bit set for each non-empty bucket
+    bool m_hasKeyRange;     // true once a key range has been declared
+    int m_minKey;           // smallest key of the declared range
+    int m_maxKey;           // largest key of the declared range
+
+    // DARY structure: an implicit d-ary heap in an array, the keys are kept
+    // next to the node pointers so sifting never touches the nodes
+    struct DaryEntry {
+        unsigned long long key; // cached key of the node
+        Node* node;         // node of the patient, m_npl holds its array index
+    };
+    vector<DaryEntry> m_dary;   // heap ordered array, the root is at index 0
+    int m_arity;            // children per node of the d-ary heap
 
     void dump(Node *pos) const; // helper function for dump
+    void measureTree(Node* root, PQueueStats& stats) const;
 
     /******************************************
     * Private function declarations go here! *
     ******************************************/
     
-    void clearRecursively(Node* node);
-    Node* copyRecursively(Node* node);
+    Node* copyHeap(Node* node);
+    Node* copyNode(Node* node);
     Node* merge(Node* a, Node* b);
+    Node* meld(Node* a, Node* b);
+    Node* pairChildren(Node* first);
+    bool isHigher(Node* a, Node* b) const;
     int getNPL(Node* node) const;
     void printPreorder(Node* node) const;
     void convertToSkewHeap(Node*& node);
-    void rebuildAsSkewHeap();
-    void rebuildAsLeftistHeap();
-    void reinsertNodes(Node* node);
+    void rebuildHeap(bool refreshKeys, unsigned int flipTies = 0);
+    void detachNodes(Node* node, vector<Node*>& nodes);
+    Node* buildHeap(vector<Node*>& heaps);
+    PatientHandle insertNode(Node* node);
+    void insertNodes(vector<Node*>& nodes);
+    Node* topNode() const;
+    void pushNode(Node* node);
+    Node* popNode();
+    void popNodes(int k, vector<Node*>& nodes);
+    void detachAll(vector<Node*>& nodes);
+    void buildFrom(vector<Node*>& nodes);
+    void copyFrom(const PQueue& rhs);
+    void stealFrom(PQueue& rhs);
+    void resetBuckets();
+    int firstBucket() const;
+    int nextBucket(int bucket) const;
+    void pushBucket(Node* node);
+    void insertBucket(Node* node);
+    Node* popBucket(int bucket);
+    bool isHigherKey(unsigned long long a, unsigned long long b) const;
+    unsigned long long packKey(int priority, unsigned int arrival) const;
+    unsigned int arrivalOf(const Node* node) const;
+    static unsigned int tieMask(HEAPTYPE heapType);
+    unsigned int nextArrivals(int count);
+    void renumberArrivals();
+    void startFrontier(vector<Node*>& frontier) const;
+    void advanceFrontier(vector<Node*>& frontier) const;
+    void pushFrontier(vector<Node*>& frontier, Node* node) const;
+    Node* checkHandle(const PatientHandle& handle) const;
+    void removeNode(Node* node);
+    void cutSubtree(Node* node);
+    void fixNPL(Node* node);
+    void unlinkBucket(Node* node);
+    void freeDead(Node* node);
+    void consolidatePending();
+    void siftUp(int index);
+    void siftDown(int index);
+    void heapifyDary();
     
     Node* getRoot() const;
 };
 
+// PQueue(Iterator first, Iterator last, prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure)
+// The bulk-load constructor builds the queue from a range of patients in O(n)
+template <class Iterator>
+PQueue::PQueue(Iterator first, Iterator last, prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure)
+    : PQueue(priFn, heapType, structure) {
+    insertPatients(first, last);
+}
+
+// emplacePatient(Args&&... args)
+// Insert a patient constructed in place from the Patient constructor arguments
+template <class... Args>
+PatientHandle PQueue::emplacePatient(Args&&... args) {
+    Node* newNode = m_pool.allocate();
+    PQUEUE_COUNT(m_counters.m_allocations);
+    newNode -> m_patient = Patient(forward<Args>(args)...);
+    return insertNode(newNode);
+}
+
+// insertPatients(Iterator first, Iterator last)
+// Insert a range of patients into the queue with a single pairwise heapify
+template <class Iterator>
+void PQueue::insertPatients(Iterator first, Iterator last) {
+    vector<Node*> nodes;
+    int count = (int) distance(first, last);
+    nodes.reserve(count + 1);
+    
+    // One slab holds every node of the range, they arrive in the order of the range
+    m_pool.reserve(count);
+    unsigned int arrival = nextArrivals(count);
+    for (; first != last; ++first) {
+        Node* node = m_pool.allocate(*first);
+        node -> m_key = packKey(m_priorFunc(node -> m_patient), arrival++);
+        PQUEUE_COUNT(m_counters.m_allocations);
+        PQUEUE_COUNT(m_counters.m_priorityCalls);
+        nodes.push_back(node);
+    }
+    
+    insertNodes(nodes);
+}
+
+// getNextPatients(int k, OutputIterator out)
+// Remove up to k patients in priority order, the queue is rebuilt only once
+template <class OutputIterator>
+int PQueue::getNextPatients(int k, OutputIterator out) {
+    vector<Node*> nodes;
+    popNodes(k, nodes);
+    for (Node* node : nodes) {
+        *out = move(node -> m_patient);
+        ++out;
+        m_pool.deallocate(node);
+    }
+    return (int) nodes.size();
+}
+
 #endif